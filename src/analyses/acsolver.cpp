@@ -19,9 +19,16 @@
  * Boston, MA 02110-1301, USA.
  */
 
+#include <algorithm>
 #include <cstring>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <vector>
 
 #include "acsolver.h"
+#include "adaptsweep.h"
 #include "analysis.h"
 #include "circuit.h"
 #include "complex.h"
@@ -43,6 +50,9 @@ acsolver::acsolver() : nasolver<nr_complex_t>() {
   setDescription("AC");
   xn = nullptr;
   noise = 0;
+  solver = ALGO_LU_DECOMPOSITION;
+  threads = 1;
+  noiseAll = true;
 }
 
 acsolver::acsolver(char *n) : nasolver<nr_complex_t>(n) {
@@ -51,6 +61,9 @@ acsolver::acsolver(char *n) : nasolver<nr_complex_t>(n) {
   setDescription("AC");
   xn = nullptr;
   noise = 0;
+  solver = ALGO_LU_DECOMPOSITION;
+  threads = 1;
+  noiseAll = true;
 }
 
 acsolver::~acsolver() {
@@ -62,6 +75,28 @@ int acsolver::solve() {
   runs++;
 
   noise = !strcmp(getPropertyString("Noise"), "yes") ? 1 : 0;
+  const char *const algo = getPropertyString("Solver");
+  setOrdering(getPropertyString("Ordering"));
+  threads = getPropertyInteger("Threads");
+  if (!strcmp(algo, "SparseLU"))
+    solver = ALGO_LU_DECOMPOSITION_SPARSE;
+  else if (!strcmp(algo, "BlockedLU"))
+    solver = ALGO_LU_DECOMPOSITION_BLOCKED;
+  else if (!strcmp(algo, "MixedLU"))
+    solver = ALGO_LU_DECOMPOSITION_MIXED;
+  else if (!strcmp(algo, "GMRES"))
+    solver = ALGO_GMRES;
+  else if (!strcmp(algo, "BiCGStab"))
+    solver = ALGO_BICGSTAB;
+  else
+    solver = ALGO_LU_DECOMPOSITION;
+  krylovTol = getPropertyDouble("KrylovTol");
+  krylovMaxIter = getPropertyInteger("KrylovMaxIter");
+  if (noise && (solver == ALGO_GMRES || solver == ALGO_BICGSTAB)) {
+    // the adjoint systems share their factors, thus are not iterated
+    logprint(LOG_STATUS, "NOTIFY: %s: noise analysis uses SparseLU instead of %s\n", getName(),
+             algo);
+  }
 
   if (swp == nullptr) {
     swp = createSweep("acfrequency");
@@ -72,23 +107,59 @@ int acsolver::solve() {
   initAC();
   setCalculation((calculate_func_t)&calcAC);
 
+  eqnAlgo = solver;
   solve_pre();
+  if (noise) {
+    createNoiseRows(getPropertyString("NoiseOutput"));
+  }
 
+  const int points = swp->getSize();
+  std::vector<double> freqs(points);
   swp->reset();
-  for (int i = 0; i < swp->getSize(); i++) {
-    freq = swp->next();
+  for (int i = 0; i < points; i++) {
+    freqs[i] = swp->next();
+  }
+
+  if (!strcmp(getPropertyString("Adaptive"), "yes") && points > 1) {
+    solve_adaptive(freqs);
+  } else if (threads > 1 && points > 1) {
+    // save the solved points in sweep order
+    std::map<int, std::pair<tvector<nr_complex_t>, tvector<double>>> solved;
+    std::vector<int> all(points);
+    int saved = 0;
+    for (int i = 0; i < points; i++) {
+      all[i] = i;
+    }
+    logprint(LOG_STATUS, "NOTIFY: %s: solving %d frequency points on %d threads\n", getName(),
+             points, threads);
+    solve_parallel(freqs, all, [&](int i) {
+      solved.emplace(i, std::make_pair(*x, noise ? *xn : tvector<double>()));
+      for (auto it = solved.begin(); it != solved.end() && it->first == saved;
+           it = solved.erase(it), saved++) {
+        *x = it->second.first;
+        saveSolution();
+        if (noise) {
+          *xn = it->second.second;
+        }
+        saveAllResults(freqs[saved]);
+      }
+    });
+  } else {
+    for (int i = 0; i < points; i++) {
+      freq = freqs[i];
 
 #if DEBUG
-    logprint(LOG_STATUS, "NOTIFY: %s: solving netlist for f = %e\n", getName(), freq);
+      logprint(LOG_STATUS, "NOTIFY: %s: solving netlist for f = %e\n", getName(), freq);
 #endif
 
-    eqnAlgo = ALGO_LU_DECOMPOSITION;
-    solve_linear();
-    if (noise) {
-      solve_noise();
-    }
+      eqnAlgo = solver;
+      solve_linear();
+      if (noise) {
+        solve_noise();
+      }
 
-    saveAllResults(freq);
+      saveAllResults(freq);
+    }
   }
 
   solve_post();
@@ -96,6 +167,181 @@ int acsolver::solve() {
   return 0;
 }
 
+/* Solves the given points of the frequency sweep on several threads.
+   The points are independent of each other: a thread takes the next
+   unsolved point, evaluates the circuits and assembles the MNA matrix
+   (and the noise correlation matrix) under a lock, since these live
+   inside the circuits, and then solves its own copy of the equation
+   system and the adjoint noise systems.  The solution of each point is
+   put into the 'x' and 'xn' vectors and passed to the given function
+   under the lock. */
+void acsolver::solve_parallel(const std::vector<double> &freqs, const std::vector<int> &todo,
+                              const std::function<void(int)> &store) {
+  const int N = countNodes();
+  const int M = countVoltageSources();
+  const int points = todo.size();
+
+  if (noise && xn == nullptr) {
+    xn = new tvector<double>(countNoiseResults());
+  }
+
+  // the equation systems and results of a single frequency point
+  struct point_t {
+    tmatrix<nr_complex_t> A;
+    tspmatrix<nr_complex_t> As;
+    tvector<nr_complex_t> x, z;
+    std::vector<noise_t> C;
+    tvector<double> xn;
+  };
+  std::mutex lock;
+  int next = 0;
+
+  auto worker = [&]() {
+    eqnsys<nr_complex_t> eqns;
+    for (;;) {
+      int i;
+      point_t p;
+      {
+        std::lock_guard<std::mutex> guard(lock);
+        if (next >= points)
+          break;
+        i = todo[next++];
+        freq = freqs[i];
+#if DEBUG
+        logprint(LOG_STATUS, "NOTIFY: %s: solving netlist for f = %e\n", getName(), freq);
+#endif
+        calculate();
+        updateMatrix = 1;
+        createMatrix();
+        if (isSparse())
+          p.As = *As;
+        else
+          p.A = *A;
+        p.z = *z;
+        if (noise) {
+          collectNoise(p.C);
+        }
+      }
+
+      // solve the equation system
+      p.x = tvector<nr_complex_t>(N + M);
+      tmatrix<nr_complex_t> An;
+      if (noise && !isSparse())
+        An = p.A; // the dense factors overwrite the matrix
+      eqns.setAlgo(solver);
+      eqns.setKrylovTol(krylovTol);
+      eqns.setKrylovMaxIter(krylovMaxIter);
+      if (isSparse())
+        eqns.passEquationSys(&p.As, &p.x, &p.z);
+      else
+        eqns.passEquationSys(&p.A, &p.x, &p.z);
+      eqns.solve();
+
+      // solve the adjoint systems for the noise voltages
+      if (noise) {
+        tvector<nr_complex_t> zn(N + M), b(N + M);
+        p.xn = tvector<double>(countNoiseResults());
+        eqns.setAlgo(factorizationAlgo(solver));
+        if (isSparse()) {
+          p.As.transpose();
+          eqns.passEquationSys(&p.As, &zn, &b);
+        } else {
+          An.transpose();
+          eqns.passEquationSys(&An, &zn, &b);
+        }
+        eqns.solve();
+        eqns.setAlgo(substitutionAlgo(solver));
+        for (auto &o : noiseRows) {
+          setAdjointSource(b, o);
+          eqns.passEquationSys((tmatrix<nr_complex_t> *)nullptr, &zn, &b);
+          eqns.solve();
+          p.xn.set(o.i, sqrt(real(contractNoise(p.C, zn, zn))));
+        }
+      }
+
+      std::lock_guard<std::mutex> guard(lock);
+      if (estack.top()) {
+        estack.print();
+      }
+      *x = p.x;
+      if (noise) {
+        *xn = p.xn;
+      }
+      store(i);
+    }
+  };
+
+  std::vector<std::thread> workers;
+  for (int t = 1; t < std::min(threads, points); t++) {
+    workers.emplace_back(worker);
+  }
+  worker();
+  for (auto &w : workers) {
+    w.join();
+  }
+}
+
+/* Runs the adaptive frequency sweep.  The quantities fitted are the
+   node voltages and branch currents and, if requested, their noise
+   powers, which unlike the noise voltages are rational functions of
+   the frequency.  The model is saved for all points of the sweep. */
+void acsolver::solve_adaptive(const std::vector<double> &freqs) {
+  const int N = countNodes();
+  const int M = countVoltageSources();
+  const int points = freqs.size();
+
+  const int K = noise ? countNoiseResults() : 0;
+
+  if (noise && xn == nullptr) {
+    xn = new tvector<double>(K);
+  }
+  adaptsweep adapt(freqs, getPropertyDouble("AdaptiveTol"));
+  auto store = [&](int i) {
+    std::vector<nr_complex_t> v(N + M + K);
+    for (int r = 0; r < N + M; r++) {
+      v[r] = x->get(r);
+    }
+    for (int r = 0; r < K; r++) {
+      v[N + M + r] = sqr(xn->get(r));
+    }
+    adapt.add(i, v);
+  };
+
+  std::vector<int> todo;
+  while (!(todo = adapt.next()).empty()) {
+    if (threads > 1 && todo.size() > 1) {
+      solve_parallel(freqs, todo, store);
+      continue;
+    }
+    for (int i : todo) {
+      freq = freqs[i];
+      eqnAlgo = solver;
+      solve_linear();
+      if (noise) {
+        solve_noise();
+      }
+      store(i);
+    }
+  }
+  logprint(LOG_STATUS,
+           "NOTIFY: %s: adaptive sweep solved %d of %d frequency points, "
+           "estimated error %g\n",
+           getName(), adapt.countSolved(), points, adapt.getError());
+
+  std::vector<nr_complex_t> v;
+  for (int i = 0; i < points; i++) {
+    adapt.evaluate(i, v);
+    for (int r = 0; r < N + M; r++) {
+      x->set(r, v[r]);
+    }
+    for (int r = 0; r < K; r++) {
+      xn->set(r, sqrt(std::max(real(v[N + M + r]), 0.0)));
+    }
+    saveSolution();
+    saveAllResults(freqs[i]);
+  }
+}
+
 /* Goes through the list of circuit objects and runs its initAC() function. */
 void acsolver::initAC() {
   logprint(LOG_STATUS, "NOTIFY: %s: acsolver::initAC()\n", getName());
@@ -105,6 +351,7 @@ void acsolver::initAC() {
     if (c->isNonLinear()) {
       c->calcOperatingPoints();
     }
+    c->setRealMNA(false);
     c->initAC();
     if (noise) {
       c->initNoiseAC();
@@ -156,21 +403,94 @@ void acsolver::saveNoiseResults(qucs::vector *f) {
   }
 
   // apply probe data
+  for (size_t k = 0; k < noiseProbes.size(); k++) {
+    circuit *c = noiseProbes[k];
+    c->setOperatingPoint("Vr", fabs(xn->get(N + M + k) * sqrt(kB * T0)));
+    c->setOperatingPoint("Vi", 0.0);
+  }
+
+  if (noiseAll) {
+    saveResults("vn", "in", 0, f);
+    return;
+  }
+
+  // save the requested results only, even inside subcircuits
+  for (auto &o : noiseRows) {
+    if (o.i >= N + M)
+      continue;
+    const int r = o.i;
+    std::string n = r < N ? createV(r, "vn", SAVE_ALL) : createI(r - N, "in", SAVE_OPS | SAVE_ALL);
+    if (!n.empty()) {
+      saveVariable(n, x->get(r), f);
+    }
+  }
+  for (circuit *c : noiseProbes) {
+    saveVariable(createOP(c->getName(), "vn"), c->getOperatingPoint("Vr"), f);
+  }
+}
+
+/* Prepares the noise analysis.  It maps the noise correlation matrix
+   of each circuit to the rows of the MNA matrix and determines the
+   unknowns the noise is computed for: all of them or those of the
+   given node, voltage probe or voltage source (e.g. a current probe).
+   Each of these costs a substitution with the adjoint matrix, for a
+   voltage probe with the difference of its nodes as source. */
+void acsolver::createNoiseRows(const char *const output) {
+  const int N = countNodes();
+  const int M = countVoltageSources();
+  auto row = [&](node *n) { return getNodeIndex(n->getName()) - 1; };
+  createNoiseMap();
+
   circuit *root = subnet->getRoot();
+  noiseRows.clear();
+  noiseProbes.clear();
+  auto probe = [&](circuit *c) {
+    const int i = N + M + noiseProbes.size();
+    noiseRows.push_back({i, row(c->getNode(NODE_1)), row(c->getNode(NODE_2))});
+    noiseProbes.push_back(c);
+  };
+  noiseAll = !strcmp(output, "all");
+  if (noiseAll) {
+    for (int r = 0; r < N + M; r++) {
+      noiseRows.push_back({r, r, -1});
+    }
+    for (circuit *c = root; c != nullptr; c = c->getNext()) {
+      if (c->isProbe())
+        probe(c);
+    }
+    return;
+  }
+  const int r = getNodeIndex(output) - 1;
+  if (r >= 0) {
+    noiseRows.push_back({r, r, -1});
+    return;
+  }
   for (circuit *c = root; c != nullptr; c = c->getNext()) {
-    if (!c->isProbe())
+    if (strcmp(c->getName(), output))
       continue;
-    int np, nn;
-    double vp, vn;
-    np = getNodeIndex(c->getNode(NODE_1)->getName());
-    vp = np > 0 ? xn->get(np - 1) : 0.0;
-    nn = getNodeIndex(c->getNode(NODE_2)->getName());
-    vn = nn > 0 ? xn->get(nn - 1) : 0.0;
-    c->setOperatingPoint("Vr", fabs((vp - vn) * sqrt(kB * T0)));
-    c->setOperatingPoint("Vi", 0.0);
+    if (c->isProbe()) {
+      probe(c);
+    } else {
+      for (int i = 0; i < c->getVoltageSources(); i++) {
+        const int r = N + c->getVoltageSource() + i;
+        noiseRows.push_back({r, r, -1});
+      }
+    }
+    if (!noiseRows.empty())
+      return;
   }
+  logprint(LOG_ERROR, "ERROR: %s: no node, probe or voltage source `%s' for noise output\n",
+           getName(), output);
+}
 
-  saveResults("vn", "in", 0, f);
+/* Sets the right hand side of the adjoint system yielding the
+   transimpedances of the given noise output. */
+void acsolver::setAdjointSource(tvector<nr_complex_t> &b, const output_t &o) {
+  b.set(0);
+  if (o.p >= 0)
+    b.set(o.p, -1);
+  if (o.n >= 0)
+    b.set(o.n, 1);
 }
 
 /* Tuns the AC noise analysis.  It saves its results in
@@ -182,12 +502,13 @@ void acsolver::solve_noise() {
   // save usual AC results
   tvector<nr_complex_t> xsave = *x;
 
-  // create the Cy matrix
-  createNoiseMatrix();
+  // collect the noise current correlations of the circuits
+  std::vector<noise_t> sources;
+  collectNoise(sources);
 
   // create noise result vector if necessary
   if (xn == nullptr) {
-    xn = new tvector<double>(N + M);
+    xn = new tvector<double>(countNoiseResults());
   }
 
   // temporary result vector for transimpedances
@@ -195,28 +516,32 @@ void acsolver::solve_noise() {
 
   // create the MNA matrix once again and LU decompose the adjoint matrix
   createMatrix();
-  A->transpose();
-  eqnAlgo = ALGO_LU_FACTORIZATION_CROUT;
+  transposeMatrix();
+  eqnAlgo = factorizationAlgo(solver);
   solveLinearEquations();
 
   // ensure skipping LU decomposition
   updateMatrix = 0;
   convHelper = CONV_None;
-  eqnAlgo = ALGO_LU_SUBSTITUTION_CROUT;
+  eqnAlgo = substitutionAlgo(solver);
 
-  // compute noise voltage for each node (and voltage source)
-  for (int i = 0; i < N + M; i++) {
-    z->set(0);
-    z->set(i, -1); // modify right hand side appropriately
-    solveLinearEquations();      // solve
-    zn = *x;       // save transimpedance vector
+  // compute noise voltage for each requested node (and voltage source)
+  for (auto &o : noiseRows) {
+    setAdjointSource(*z, o); // modify right hand side appropriately
+    solveLinearEquations();  // solve
+    zn = *x;                 // save transimpedance vector
 
     // compute actual noise voltage
-    xn->set(i, sqrt(real(scalar(zn * (*C), conj(zn)))));
+    xn->set(o.i, sqrt(real(contractNoise(sources, zn, zn))));
   }
 
   // restore usual AC results
   *x = xsave;
+
+  // restore the structure of the sparse matrix for the next frequency
+  if (isSparse()) {
+    transposeMatrix();
+  }
 }
 
 PROP_REQ[] = {
@@ -229,6 +554,14 @@ PROP_OPT[] = {
     {"Stop", PROP_REAL, {10e9, PROP_NO_STR}, PROP_POS_RANGE},
     {"Points", PROP_INT, {10, PROP_NO_STR}, PROP_MIN_VAL(2)},
     {"Values", PROP_LIST, {10, PROP_NO_STR}, PROP_POS_RANGE},
+    {"Solver", PROP_STR, {PROP_NO_VAL, "CroutLU"}, PROP_RNG_STR6("CroutLU", "SparseLU", "BlockedLU", "MixedLU", "GMRES", "BiCGStab")},
+    {"KrylovTol", PROP_REAL, {1e-12, PROP_NO_STR}, PROP_RNG_X01I},
+    {"KrylovMaxIter", PROP_INT, {0, PROP_NO_STR}, PROP_RNGII(0, 100000)},
+    {"Threads", PROP_INT, {1, PROP_NO_STR}, PROP_RNGII(1, 256)},
+    {"Ordering", PROP_STR, {PROP_NO_VAL, "none"}, PROP_RNG_STR3("none", "RCM", "MinDegree")},
+    {"NoiseOutput", PROP_STR, {PROP_NO_VAL, "all"}, PROP_NO_RANGE},
+    {"Adaptive", PROP_STR, {PROP_NO_VAL, "no"}, PROP_RNG_YESNO},
+    {"AdaptiveTol", PROP_REAL, {1e-6, PROP_NO_STR}, PROP_RNG_X01I},
     PROP_NO_PROP,
 };
 struct define_t acsolver::anadef = {"AC", 0, PROP_ACTION, PROP_NO_SUBSTRATE, PROP_LINEAR, PROP_DEF};
@@ -22,6 +22,10 @@
 #ifndef __ACSOLVER_H__
 #define __ACSOLVER_H__
 
+#include <functional>
+#include <utility>
+#include <vector>
+
 #include "nasolver.h"
 
 namespace qucs {
@@ -39,16 +43,37 @@ public:
 
 private:
   void solve_noise();
+  void solve_parallel(const std::vector<double> &, const std::vector<int> &,
+                      const std::function<void(int)> &);
+  void solve_adaptive(const std::vector<double> &);
   void initAC();
   static void calcAC(acsolver *);
   void saveAllResults(double);
   void saveNoiseResults(qucs::vector *);
+  void createNoiseRows(const char *);
+
+  /* A noise output: the noise of the unknown p, or of the difference
+     of the unknowns p and n for voltage probes (-1 for the ground), is
+     stored at index i of the noise results. */
+  struct output_t {
+    int i, p, n;
+  };
+  static void setAdjointSource(tvector<nr_complex_t> &, const output_t &);
+  int countNoiseResults() {
+    return countNodes() + countVoltageSources() + noiseProbes.size();
+  }
 
 private:
   sweep *swp;
   double freq;
   int noise;
+  int solver;
+  int threads;
   tvector<double> *xn;
+  // the noise outputs, those of the voltage probes follow the unknowns
+  std::vector<output_t> noiseRows;
+  std::vector<circuit *> noiseProbes;
+  bool noiseAll;
 };
 
 } // namespace qucs
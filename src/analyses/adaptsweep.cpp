@@ -0,0 +1,391 @@
+/*
+ * adaptsweep.cpp - adaptive frequency sampling class implementation
+ *
+ * This is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this package; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street - Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <random>
+
+#include "adaptsweep.h"
+#include "complex.h"
+#include "consts.h"
+
+namespace qucs {
+
+// number of initially solved points
+static const int initialPoints = 9;
+// maximum number of points solved per iteration
+static const int maximumBatch = 16;
+// maximum number of quantities the model is fitted to
+static const int maximumProbes = 16;
+// quantities below this fraction of the largest one are compared absolutely
+static const double scaleFloor = 1e-10;
+
+adaptsweep::adaptsweep(const std::vector<double> &grid, double tol)
+    : grid(grid), tol(tol), values(grid.size()), probed(grid.size()) {
+  fits = 0;
+  passed = 0;
+  error = std::numeric_limits<double>::infinity();
+}
+
+/* Stores the quantities of a solved grid point. */
+void adaptsweep::add(int i, const std::vector<nr_complex_t> &v) {
+  values[i] = v;
+  samples.push_back(i);
+  scale.resize(v.size(), 0.0);
+  for (size_t k = 0; k < v.size(); k++) {
+    scale[k] = std::max(scale[k], std::abs(v[k]));
+  }
+}
+
+/* Returns the grid points to be solved next, none if the model is
+   accurate enough or all points have been solved. */
+std::vector<int> adaptsweep::next() {
+  const int size = grid.size();
+  std::vector<int> points;
+
+  // start with a few points evenly spread over the grid
+  if (samples.empty()) {
+    const int n = std::min(size, initialPoints);
+    for (int k = 0; k < n; k++) {
+      int i = n > 1 ? (int)std::lround((double)k * (size - 1) / (n - 1)) : 0;
+      if (points.empty() || points.back() != i)
+        points.push_back(i);
+    }
+    return points;
+  }
+  if ((int)samples.size() >= size) {
+    error = 0;
+    return points;
+  }
+
+  probe();
+  previous = model;
+  fit(model);
+
+  // without a previous model refine halfway between the samples
+  if (fits++ == 0) {
+    std::vector<int> solved = samples;
+    std::sort(solved.begin(), solved.end());
+    for (size_t j = 1; j < solved.size(); j++) {
+      if (solved[j] - solved[j - 1] > 1)
+        points.push_back((solved[j] + solved[j - 1]) / 2);
+    }
+    return points;
+  }
+
+  // estimate the error at the unsolved points
+  std::vector<double> err(size, 0.0);
+  std::vector<nr_complex_t> a, b;
+  error = 0;
+  int worst = -1;
+  for (int i = 0; i < size; i++) {
+    if (!values[i].empty())
+      continue;
+    evaluate(model, grid[i], probed, a);
+    evaluate(previous, grid[i], probed, b);
+    double e = deviation(a, b);
+    err[i] = std::isfinite(e) ? e : std::numeric_limits<double>::max();
+    if (worst < 0 || err[i] > err[worst])
+      worst = i;
+    error = std::max(error, err[i]);
+  }
+  if (error <= tol) {
+    if (++passed >= 2)
+      return points;
+  } else {
+    passed = 0;
+  }
+
+  // solve the local maxima of the error above the tolerance
+  for (int i = 0; i < size; i++) {
+    if (values[i].empty() && err[i] > tol && (i == 0 || err[i] > err[i - 1]) &&
+        (i == size - 1 || err[i] >= err[i + 1]))
+      points.push_back(i);
+  }
+  std::sort(points.begin(), points.end(), [&](int i, int j) { return err[i] > err[j]; });
+  if ((int)points.size() > maximumBatch)
+    points.resize(maximumBatch);
+  // or verify the model at its worst point
+  if (points.empty())
+    points.push_back(worst);
+  return points;
+}
+
+/* Returns the quantities of the given grid point, either solved or
+   evaluated by the model. */
+void adaptsweep::evaluate(int i, std::vector<nr_complex_t> &v) const {
+  if (!values[i].empty())
+    v = values[i];
+  else
+    evaluate(model, grid[i], values, v);
+}
+
+/* Evaluates the barycentric model r(f) = sum w_l F_l / (f - f_l) / sum
+   w_l / (f - f_l) of the given quantities at the given frequency. */
+void adaptsweep::evaluate(const model_t &m, double f,
+                          const std::vector<std::vector<nr_complex_t>> &F,
+                          std::vector<nr_complex_t> &v) const {
+  std::vector<nr_complex_t> c(m.support.size());
+  nr_complex_t d = 0.0;
+  for (size_t l = 0; l < m.support.size(); l++) {
+    double x = grid[m.support[l]];
+    if (f == x) {
+      v = F[m.support[l]];
+      return;
+    }
+    c[l] = m.w[l] / (f - x);
+    d += c[l];
+  }
+  v.assign(F[samples[0]].size(), 0.0);
+  for (size_t l = 0; l < m.support.size(); l++) {
+    const std::vector<nr_complex_t> &Fl = F[m.support[l]];
+    nr_complex_t t = c[l] / d;
+    for (size_t k = 0; k < v.size(); k++) {
+      v[k] += t * Fl[k];
+    }
+  }
+}
+
+/* Returns the largest difference of two sets of probed quantities. */
+double adaptsweep::deviation(const std::vector<nr_complex_t> &a,
+                             const std::vector<nr_complex_t> &b) {
+  double e = 0;
+  for (size_t k = 0; k < a.size(); k++) {
+    double d = std::abs(a[k] - b[k]);
+    if (!(d <= e))
+      e = d;
+  }
+  return e;
+}
+
+/* Computes the probed quantities of the solved points the model is
+   fitted to.  These are the quantities divided by their largest
+   magnitude or, if there are many of them, a few random combinations
+   of these.  Since the barycentric weights are common to all quantities
+   the combinations yield the same poles and save most of the effort,
+   while an error of a single quantity still shows in each of them. */
+void adaptsweep::probe() {
+  const int K = scale.size();
+  double largest = 0;
+  for (double s : scale)
+    largest = std::max(largest, s);
+  std::vector<double> norm(K);
+  for (int k = 0; k < K; k++) {
+    double s = std::max(scale[k], scaleFloor * largest);
+    norm[k] = s > 0 ? 1 / s : 0;
+  }
+  if (K > maximumProbes && phases.empty()) {
+    std::minstd_rand random;
+    std::uniform_real_distribution<double> phase(0, 2 * pi);
+    phases.resize(maximumProbes * K);
+    for (auto &c : phases)
+      c = std::polar(1.0, phase(random));
+  }
+
+  for (int i : samples) {
+    const std::vector<nr_complex_t> &v = values[i];
+    std::vector<nr_complex_t> &p = probed[i];
+    if (K <= maximumProbes) {
+      p.resize(K);
+      for (int k = 0; k < K; k++)
+        p[k] = v[k] * norm[k];
+      continue;
+    }
+    p.assign(maximumProbes, 0.0);
+    for (int n = 0; n < maximumProbes; n++) {
+      const nr_complex_t *c = &phases[n * K];
+      for (int k = 0; k < K; k++)
+        p[n] += c[k] * v[k] * norm[k];
+    }
+  }
+}
+
+/* Fits the model to the probed quantities of the solved points.  The
+   AAA algorithm starts from the support points of the last model and
+   determines the weights from the null vector of the Loewner matrix
+   (F_i - F_l) / (f_i - f_l) of the other samples i stacked for all
+   quantities.  It then takes the sample worst approximated as a new
+   support point until the samples are matched well below the tolerance
+   or half of them are support points. */
+void adaptsweep::fit(model_t &m) const {
+  const int n = samples.size();
+  std::vector<bool> support(n, false);
+  std::vector<int> sup;
+  for (int j = 0; j < n; j++) {
+    if (std::find(m.support.begin(), m.support.end(), samples[j]) != m.support.end()) {
+      support[j] = true;
+      sup.push_back(j);
+    }
+  }
+
+  std::vector<double> err(n, 0.0);
+  std::vector<nr_complex_t> r;
+  for (;;) {
+    double e = 0;
+    if (sup.empty()) {
+      // the mean of the samples
+      r.assign(probed[samples[0]].size(), 0.0);
+      for (int j = 0; j < n; j++) {
+        for (size_t k = 0; k < r.size(); k++)
+          r[k] += probed[samples[j]][k] / (double)n;
+      }
+      for (int j = 0; j < n; j++) {
+        err[j] = deviation(probed[samples[j]], r);
+        e = std::max(e, err[j]);
+      }
+    } else {
+      // the Loewner matrix by columns
+      std::vector<std::vector<nr_complex_t>> A(sup.size());
+      for (size_t l = 0; l < sup.size(); l++) {
+        const std::vector<nr_complex_t> &Fl = probed[samples[sup[l]]];
+        double xl = grid[samples[sup[l]]];
+        A[l].reserve((n - sup.size()) * Fl.size());
+        for (int i = 0; i < n; i++) {
+          if (support[i])
+            continue;
+          const std::vector<nr_complex_t> &Fi = probed[samples[i]];
+          double dx = grid[samples[i]] - xl;
+          for (size_t k = 0; k < Fl.size(); k++)
+            A[l].push_back((Fi[k] - Fl[k]) / dx);
+        }
+      }
+      m.w = nullVector(A);
+      m.support.clear();
+      for (int l : sup)
+        m.support.push_back(samples[l]);
+
+      // the approximation error at the other samples
+      for (int i = 0; i < n; i++) {
+        err[i] = 0;
+        if (support[i])
+          continue;
+        evaluate(m, grid[samples[i]], probed, r);
+        err[i] = deviation(probed[samples[i]], r);
+        if (!(err[i] <= e))
+          e = err[i];
+      }
+    }
+    if (e <= tol * 1e-2 || (int)sup.size() >= (n + 1) / 2)
+      break;
+
+    int j = -1;
+    for (int i = 0; i < n; i++) {
+      if (!support[i] && (j < 0 || !(err[i] <= err[j])))
+        j = i;
+    }
+    support[j] = true;
+    sup.push_back(j);
+  }
+}
+
+/* Returns the right singular vector of the smallest singular value of
+   the given matrix (by columns).  The matrix is reduced to a triangular
+   one by Householder reflections whose columns are then orthogonalized
+   by one-sided Jacobi rotations.  The matrix is overwritten. */
+std::vector<nr_complex_t> adaptsweep::nullVector(std::vector<std::vector<nr_complex_t>> &A) {
+  const int m = A.size();
+  const int rows = m > 0 ? A[0].size() : 0;
+  std::vector<nr_complex_t> v(m, 1.0);
+  if (rows == 0 || m == 1)
+    return v;
+
+  // QR decomposition, R is kept in the upper triangle
+  std::vector<nr_complex_t> h(rows);
+  for (int j = 0; j < std::min(rows, m); j++) {
+    double s = 0;
+    for (int i = j; i < rows; i++)
+      s += std::norm(A[j][i]);
+    s = std::sqrt(s);
+    if (s == 0)
+      continue;
+    nr_complex_t a = A[j][j] == 0.0 ? -s : -s * A[j][j] / std::abs(A[j][j]);
+    double hn = 0;
+    for (int i = j; i < rows; i++) {
+      h[i] = A[j][i] - (i == j ? a : 0.0);
+      hn += std::norm(h[i]);
+    }
+    hn = std::sqrt(hn);
+    for (int i = j; i < rows; i++)
+      h[i] /= hn;
+    for (int k = j; k < m; k++) {
+      nr_complex_t p = 0.0;
+      for (int i = j; i < rows; i++)
+        p += conj(h[i]) * A[k][i];
+      for (int i = j; i < rows; i++)
+        A[k][i] -= 2.0 * h[i] * p;
+    }
+  }
+  std::vector<std::vector<nr_complex_t>> B(m, std::vector<nr_complex_t>(m, 0.0));
+  std::vector<std::vector<nr_complex_t>> V(m, std::vector<nr_complex_t>(m, 0.0));
+  for (int k = 0; k < m; k++) {
+    for (int i = 0; i <= k && i < rows; i++)
+      B[k][i] = A[k][i];
+    V[k][k] = 1.0;
+  }
+
+  // one-sided Jacobi: B * V gets orthogonal columns
+  for (int sweep = 0; sweep < 50; sweep++) {
+    bool rotated = false;
+    for (int p = 0; p < m - 1; p++) {
+      for (int q = p + 1; q < m; q++) {
+        double alpha = 0, beta = 0;
+        nr_complex_t g = 0.0;
+        for (int i = 0; i < m; i++) {
+          alpha += std::norm(B[p][i]);
+          beta += std::norm(B[q][i]);
+          g += conj(B[p][i]) * B[q][i];
+        }
+        double ga = std::abs(g);
+        if (ga == 0 || ga <= 1e-15 * std::sqrt(alpha * beta))
+          continue;
+        rotated = true;
+        double zeta = (beta - alpha) / (2 * ga);
+        double t = (zeta >= 0 ? 1 : -1) / (std::abs(zeta) + std::sqrt(1 + zeta * zeta));
+        double c = 1 / std::sqrt(1 + t * t), s = c * t;
+        nr_complex_t e = conj(g) / ga;
+        for (int i = 0; i < m; i++) {
+          nr_complex_t bp = B[p][i], bq = B[q][i] * e;
+          B[p][i] = c * bp - s * bq;
+          B[q][i] = s * bp + c * bq;
+          nr_complex_t vp = V[p][i], vq = V[q][i] * e;
+          V[p][i] = c * vp - s * vq;
+          V[q][i] = s * vp + c * vq;
+        }
+      }
+    }
+    if (!rotated)
+      break;
+  }
+
+  int j = 0;
+  double smallest = std::numeric_limits<double>::max();
+  for (int k = 0; k < m; k++) {
+    double s = 0;
+    for (int i = 0; i < m; i++)
+      s += std::norm(B[k][i]);
+    if (s < smallest) {
+      smallest = s;
+      j = k;
+    }
+  }
+  return V[j];
+}
+
+} // namespace qucs
@@ -0,0 +1,85 @@
+/*
+ * adaptsweep.h - adaptive frequency sampling class definitions
+ *
+ * This is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this package; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street - Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef __ADAPTSWEEP_H__
+#define __ADAPTSWEEP_H__
+
+#include <vector>
+
+#include "complex.h"
+
+namespace qucs {
+
+/* Adaptive sampling of a frequency sweep.  Instead of solving the
+   network at every point of the requested grid only a few points are
+   solved and a rational model of all output quantities is fitted to
+   them.  The fit is a set-valued AAA approximation: a barycentric
+   rational function with the same support points and weights for all
+   quantities, i.e. with common poles, whose weights minimize the
+   linearized error at the other samples.  The error of the model at
+   the unsolved points is estimated by the difference to the model of
+   the previous iteration and new points are solved where it is
+   largest, until it is below the tolerance relative to the largest
+   magnitude of each quantity twice in a row.  The model is then
+   evaluated on the full grid, solved points keep their exact values.
+
+   The caller loops over next(), solves the returned grid points and
+   passes their quantities to add(); afterwards evaluate() yields the
+   quantities of each grid point. */
+class adaptsweep {
+public:
+  adaptsweep(const std::vector<double> &, double);
+
+  std::vector<int> next();
+  void add(int, const std::vector<nr_complex_t> &);
+  void evaluate(int, std::vector<nr_complex_t> &) const;
+  int countSolved() const { return samples.size(); }
+  double getError() const { return error; }
+
+private:
+  /* A barycentric rational model: its support points (grid indices)
+     and their weights. */
+  struct model_t {
+    std::vector<int> support;
+    std::vector<nr_complex_t> w;
+  };
+  void probe();
+  void fit(model_t &) const;
+  void evaluate(const model_t &, double, const std::vector<std::vector<nr_complex_t>> &,
+                std::vector<nr_complex_t> &) const;
+  static double deviation(const std::vector<nr_complex_t> &, const std::vector<nr_complex_t> &);
+  static std::vector<nr_complex_t> nullVector(std::vector<std::vector<nr_complex_t>> &);
+
+private:
+  std::vector<double> grid;
+  double tol;
+  std::vector<int> samples;                       // solved grid points
+  std::vector<std::vector<nr_complex_t>> values;  // quantities, empty unless solved
+  std::vector<std::vector<nr_complex_t>> probed;  // quantities the model is fitted to
+  std::vector<double> scale;                      // largest magnitude of each quantity
+  std::vector<nr_complex_t> phases;               // random combinations of the quantities
+  model_t model, previous;
+  int fits;
+  int passed;
+  double error;
+};
+
+} // namespace qucs
+
+#endif /* __ADAPTSWEEP_H__ */
@@ -63,11 +63,18 @@ public:
   virtual ~analysis();
 
   int getType() const { return this->type; }
+  int getRuns() const { return this->runs; }
+  void setRuns(int runs) { this->runs = runs; }
 
   virtual int initialize() { return 0; }
   virtual int solve() { return 0; }
   virtual int cleanup() { return 0; }
 
+  /* Requests the next solve() to start from the solutions of the
+     previous points of a parameter sweep extrapolated to the given
+     parameter value, forgetting these solutions at the first point. */
+  virtual void setContinuation(double, bool) {}
+
   dataset *getData() const { return this->data; }
   void setData(dataset *data) { this->data = data; }
 
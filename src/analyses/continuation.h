@@ -0,0 +1,70 @@
+/*
+ * continuation.h - parameter sweep continuation class definitions
+ *
+ * This is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this package; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street - Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef __CONTINUATION_H__
+#define __CONTINUATION_H__
+
+#include <algorithm>
+
+#include "tvector.h"
+
+namespace qucs {
+
+/* The converged solutions of the last two points of a parameter sweep.
+   The solution of the next point is predicted from these by linear
+   extrapolation in the swept parameter, or is the last solution if
+   there is only one. */
+template <class nr_type_t> class continuation {
+public:
+  void reset() { points = 0; }
+
+  void store(double p, const tvector<nr_type_t> &x) {
+    if (points > 0 && param[0] == p) {
+      solution[0] = x;
+      return;
+    }
+    solution[1] = solution[0];
+    param[1] = param[0];
+    solution[0] = x;
+    param[0] = p;
+    points = std::min(points + 1, 2);
+  }
+
+  bool predict(double p, tvector<nr_type_t> &x) const {
+    if (points == 0 || solution[0].size() != x.size())
+      return false;
+    x = solution[0];
+    if (points > 1 && solution[1].size() == x.size()) {
+      double t = (p - param[0]) / (param[0] - param[1]);
+      for (std::size_t i = 0; i < x.size(); i++) {
+        x(i) = solution[0](i) + t * (solution[0](i) - solution[1](i));
+      }
+    }
+    return true;
+  }
+
+private:
+  tvector<nr_type_t> solution[2];
+  double param[2];
+  int points = 0;
+};
+
+} // namespace qucs
+
+#endif /* __CONTINUATION_H__ */
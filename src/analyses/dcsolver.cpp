@@ -62,6 +62,12 @@ int dcsolver::solve() {
 
   saveOPs |= !strcmp(getPropertyString("saveOPs"), "yes") ? SAVE_OPS : 0;
   saveOPs |= !strcmp(getPropertyString("saveAll"), "yes") ? SAVE_ALL : 0;
+  bypass = !strcmp(getPropertyString("Bypass"), "yes");
+  bypassed = 0;
+  reuseMax = getPropertyInteger("JacobianReuse");
+  condense = !strcmp(getPropertyString("Condense"), "yes");
+  setOrdering(getPropertyString("Ordering"));
+  factorizations = 0;
 
   // initialize node voltages, first guess for non-linear circuits and
   // generate extra circuits if necessary
@@ -79,6 +85,16 @@ int dcsolver::solve() {
     eqnAlgo = ALGO_QR_DECOMPOSITION_LS;
   else if (!strcmp(solver, "GolubSVD"))
     eqnAlgo = ALGO_SV_DECOMPOSITION;
+  else if (!strcmp(solver, "SparseLU"))
+    eqnAlgo = ALGO_LU_DECOMPOSITION_SPARSE;
+  else if (!strcmp(solver, "BlockedLU"))
+    eqnAlgo = ALGO_LU_DECOMPOSITION_BLOCKED;
+  else if (!strcmp(solver, "GMRES"))
+    eqnAlgo = ALGO_GMRES;
+  else if (!strcmp(solver, "BiCGStab"))
+    eqnAlgo = ALGO_BICGSTAB;
+  krylovTol = getPropertyDouble("KrylovTol");
+  krylovMaxIter = getPropertyInteger("KrylovMaxIter");
 
   // Allocate the nodes, SLE matrices and vectors.
   solve_pre();
@@ -126,6 +142,16 @@ int dcsolver::solve() {
         }
       }
     } while (retry);
+    if (!error) {
+      storeContinuation();
+    }
+  }
+
+  if (bypass) {
+    logprint(LOG_STATUS, "NOTIFY: %s: %d device evaluations bypassed\n", getName(), bypassed);
+  }
+  if (reuseMax > 0) {
+    logprint(LOG_STATUS, "NOTIFY: %s: %d matrix factorizations\n", getName(), factorizations);
   }
 
   // save results and cleanup the solver
@@ -144,6 +170,7 @@ void dcsolver::initDC() {
 
   circuit *root = subnet->getRoot();
   for (circuit *c = root; c != nullptr; c = c->getNext()) {
+    c->setRealMNA(true);
     c->initDC();
   }
 }
@@ -154,6 +181,8 @@ void dcsolver::calcDC(dcsolver *self) {
 
   circuit *root = self->getNet()->getRoot();
   for (circuit *c = root; c != nullptr; c = c->getNext()) {
+    if (self->bypassCircuit(c))
+      continue;
     c->calcDC();
   }
 }
@@ -181,6 +210,12 @@ PROP_OPT[] = {
     {"Temp", PROP_REAL, {26.85, PROP_NO_STR}, PROP_MIN_VAL(K)},
     {"saveAll", PROP_STR, {PROP_NO_VAL, "no"}, PROP_RNG_YESNO},
     {"Solver", PROP_STR, {PROP_NO_VAL, "CroutLU"}, PROP_RNG_SOL},
+    {"KrylovTol", PROP_REAL, {1e-12, PROP_NO_STR}, PROP_RNG_X01I},
+    {"KrylovMaxIter", PROP_INT, {0, PROP_NO_STR}, PROP_RNGII(0, 100000)},
+    {"Bypass", PROP_STR, {PROP_NO_VAL, "no"}, PROP_RNG_YESNO},
+    {"JacobianReuse", PROP_INT, {0, PROP_NO_STR}, PROP_RNGII(0, 100)},
+    {"Condense", PROP_STR, {PROP_NO_VAL, "no"}, PROP_RNG_YESNO},
+    {"Ordering", PROP_STR, {PROP_NO_VAL, "none"}, PROP_RNG_STR3("none", "RCM", "MinDegree")},
     PROP_NO_PROP,
 };
 struct define_t dcsolver::anadef = {"DC", 0, PROP_ACTION, PROP_NO_SUBSTRATE, PROP_LINEAR, PROP_DEF};
@@ -55,9 +55,14 @@ hbsolver::hbsolver () : analysis () {
   nlnodes = lnnodes = banodes = nanodes = NULL;
   Y = Z = A = NULL;
   NA = YV = JQ = JG = JF = NULL;
+  YB = NULL;
+  GT = CT = PI = XT = GX = QX = NULL;
   OM = IR = QR = RH = IG = FQ = VS = VP = FV = IL = IN = IC = IS = NULL;
   vs = x = NULL;
-  runs = 0;
+  threads = 1;
+  matrixFree = 0;
+  contParam = 0;
+  contEnabled = contPending = 0;
   ndfreqs = NULL;
 }
 
@@ -67,9 +72,14 @@ hbsolver::hbsolver (char * n) : analysis (n) {
   nlnodes = lnnodes = banodes = nanodes = NULL;
   Y = Z = A = NULL;
   NA = YV = JQ = JG = JF = NULL;
+  YB = NULL;
+  GT = CT = PI = XT = GX = QX = NULL;
   OM = IR = QR = RH = IG = FQ = VS = VP = FV = IL = IN = IC = IS = NULL;
   vs = x = NULL;
-  runs = 0;
+  threads = 1;
+  matrixFree = 0;
+  contParam = 0;
+  contEnabled = contPending = 0;
   ndfreqs = NULL;
 }
 
@@ -88,9 +98,16 @@ hbsolver::~hbsolver () {
   // delete matrices
   delete NA;
   delete YV;
+  delete YB;
   delete JQ;
   delete JG;
   delete JF;
+  delete GT;
+  delete CT;
+  delete PI;
+  delete XT;
+  delete GX;
+  delete QX;
 
   // delete vectors
   delete IC;
@@ -121,6 +138,8 @@ int hbsolver::solve (void) {
 
   int iterations = 0, done = 0;
   int MaxIterations = getPropertyInteger ("MaxIter");
+  threads = getPropertyInteger ("Threads");
+  matrixFree = !strcmp (getPropertyString ("Solver"), "GMRES");
 
   // collect different parts of the circuit
   splitCircuits ();
@@ -147,8 +166,19 @@ int hbsolver::solve (void) {
     // prepares the non-linear part
     prepareNonLinear ();
 
+    // start from the voltages of the previous sweep points
+    if (contPending) {
+      contPending = 0;
+      if (contVS.predict (contParam, *VS) && contvs.predict (contParam, *vs)) {
+	logprint (LOG_STATUS, "NOTIFY: %s: starting from the previous sweep "
+		  "points\n", getName ());
+      }
+    }
+
 #if HB_DEBUG
-      fprintf (stderr, "YV -- transY in f:\n"); YV->print ();
+      if (YV != NULL) {
+	fprintf (stderr, "YV -- transY in f:\n"); YV->print ();
+      }
       fprintf (stderr, "IC -- constant current in f:\n"); IC->print ();
 #endif
 
@@ -199,31 +229,41 @@ int hbsolver::solve (void) {
       // termination criteria met
       if (iterations > 1 && checkBalance ()) {
 	done = 1;
+	if (contEnabled) {
+	  contVS.store (contParam, *VS);
+	  contvs.store (contParam, *vs);
+	}
 	break;
       }
 
+      if (matrixFree) {
+	// the Jacobian is applied using FFTs, just the preconditioner
+	calcPreconditioner ();
+      }
+      else {
 #if HB_DEBUG
-      fprintf (stderr, "JG -- G-Jacobian in t:\n"); JG->print ();
-      fprintf (stderr, "JQ -- C-Jacobian in t:\n"); JQ->print ();
+	fprintf (stderr, "JG -- G-Jacobian in t:\n"); JG->print ();
+	fprintf (stderr, "JQ -- C-Jacobian in t:\n"); JQ->print ();
 #endif
 
-      // G-Jacobian into frequency domain
-      MatrixFFT (JG);
+	// G-Jacobian into frequency domain
+	MatrixFFT (JG);
 
-      // C-Jacobian into frequency domain
-      MatrixFFT (JQ);
+	// C-Jacobian into frequency domain
+	MatrixFFT (JQ);
 
 #if HB_DEBUG
-      fprintf (stderr, "JQ -- dQ/dV C-Jacobian in f:\n"); JQ->print ();
-      fprintf (stderr, "JG -- dI/dV G-Jacobian in f:\n"); JG->print ();
+	fprintf (stderr, "JQ -- dQ/dV C-Jacobian in f:\n"); JQ->print ();
+	fprintf (stderr, "JG -- dI/dV G-Jacobian in f:\n"); JG->print ();
 #endif
 
-      // calculate Jacobian --> JF = [YV] + j[O] * JQ + JG
-      calcJacobian ();
+	// calculate Jacobian --> JF = [YV] + j[O] * JQ + JG
+	calcJacobian ();
 
 #if HB_DEBUG
-      fprintf (stderr, "JF -- full Jacobian in f:\n"); JF->print ();
+	fprintf (stderr, "JF -- full Jacobian in f:\n"); JF->print ();
 #endif
+      }
 
       // solve equation system --> JF * VS(n+1) = JF * VS(n) - FV
       solveVoltages ();
@@ -268,6 +308,18 @@ int hbsolver::solve (void) {
   return 0;
 }
 
+/* Enables the continuation of a parameter sweep: the balancing
+   starts from the voltages of the previous sweep points extrapolated
+   to the given parameter value. */
+void hbsolver::setContinuation (double p, bool first) {
+  if (first) {
+    contVS.reset ();
+    contvs.reset ();
+  }
+  contParam = p;
+  contEnabled = contPending = 1;
+}
+
 /* Goes through the list of circuit objects and runs its calcHB()
    function. */
 void hbsolver::calc (hbsolver * self) {
@@ -282,6 +334,7 @@ void hbsolver::calc (hbsolver * self) {
 void hbsolver::initHB (void) {
   circuit * root = subnet->getRoot ();
   for (circuit * c = root; c != NULL; c = (circuit *) c->getNext ()) {
+    c->setRealMNA (false);
     c->initHB ();
   }
 }
@@ -291,6 +344,7 @@ void hbsolver::initHB (void) {
 void hbsolver::initDC (void) {
   circuit * root = subnet->getRoot ();
   for (circuit * c = root; c != NULL; c = (circuit *) c->getNext ()) {
+    c->setRealMNA (false);
     c->initDC ();
   }
 }
@@ -630,10 +684,12 @@ void hbsolver::invertMatrix (tmatrix<nr_complex_t> * A,
   int N = A->getCols ();
   tvector<nr_complex_t> * x = new tvector<nr_complex_t> (N);
   tvector<nr_complex_t> * z = new tvector<nr_complex_t> (N);
+  eqns.setThreads (threads);
 
   try_running () {
-    // create LU decomposition of the A matrix
-    eqns.setAlgo (ALGO_LU_FACTORIZATION_CROUT);
+    // create LU decomposition of the A matrix, blocked if threaded
+    eqns.setAlgo (threads > 1 ? ALGO_LU_FACTORIZATION_BLOCKED :
+		  ALGO_LU_FACTORIZATION_CROUT);
     eqns.passEquationSys (A, x, z);
     eqns.solve ();
   }
@@ -645,14 +701,9 @@ void hbsolver::invertMatrix (tmatrix<nr_complex_t> * A,
   }
 
   // use the LU decomposition to obtain the inverse H
-  eqns.setAlgo (ALGO_LU_SUBSTITUTION_CROUT);
-  for (int c = 0; c < N; c++) {
-    z->set (0.0);
-    z->set (c, 1.0);
-    eqns.passEquationSys (A, x, z);
-    eqns.solve ();
-    for (int r = 0; r < N; r++) H->set (r, c, x->get (r));
-  }
+  eqns.setAlgo (threads > 1 ? ALGO_LU_SUBSTITUTION_DOOLITTLE :
+		ALGO_LU_SUBSTITUTION_CROUT);
+  eqns.invert (H);
   delete x;
   delete z;
 }
@@ -672,6 +723,7 @@ void hbsolver::invertMatrix (tmatrix<nr_complex_t> * A,
 #define ZCL_(r,c) Z_((r)*lnfreqs+f+sn,(c)*lnfreqs+f+sn)
 
 #define YV_(r,c) (*YV) (r,c)
+#define YB_(f,r,c) (*YB) (((f) * nbanodes + (r)) * nbanodes + (c))
 #define NA_(r,c) (*NA) (r,c)
 #define JF_(r,c) (*JF) (r,c)
 
@@ -732,8 +784,10 @@ void hbsolver::createMatrixLinearY (void) {
   }
 
   // LU decompose the MNA matrix
+  eqns.setThreads (threads);
   try_running () {
-    eqns.setAlgo (ALGO_LU_FACTORIZATION_CROUT);
+    eqns.setAlgo (threads > 1 ? ALGO_LU_FACTORIZATION_BLOCKED :
+		  ALGO_LU_FACTORIZATION_CROUT);
     eqns.passEquationSys (A, V, I);
     eqns.solve ();
   }
@@ -745,7 +799,8 @@ void hbsolver::createMatrixLinearY (void) {
   }
 
   // acquire variable transimpedance matrix entries
-  eqns.setAlgo (ALGO_LU_SUBSTITUTION_CROUT);
+  eqns.setAlgo (threads > 1 ? ALGO_LU_SUBSTITUTION_DOOLITTLE :
+		ALGO_LU_SUBSTITUTION_CROUT);
   for (c = 0; c < sn; c++) {
     I->set (0.0);
     I_(c) = 1.0;
@@ -813,11 +868,18 @@ void hbsolver::createMatrixLinearY (void) {
   // substract the 100 Ohm resistor
   for (c = 0; c < sy * lnfreqs; c++) Y_(c, c) -= 0.01;
 
-  // extract the variable transadmittance matrix
-  YV = new tmatrix<nr_complex_t> (sv * nlfreqs);
-
-  // variable transadmittance matrix must be continued conjugately
-  *YV = expandMatrix (*Y, sv);
+  // extract the variable transadmittance matrix, it must be continued
+  // conjugately; the matrix-free solution keeps the blocks of equal
+  // frequencies only
+  delete YV; YV = NULL;
+  delete YB; YB = NULL;
+  if (matrixFree) {
+    YB = new tvector<nr_complex_t> (expandBlocks (*Y, sv));
+  }
+  else {
+    YV = new tmatrix<nr_complex_t> (sv * nlfreqs);
+    *YV = expandMatrix (*Y, sv);
+  }
 
   // delete overall temporary MNA matrix
   delete A; A = NULL;
@@ -923,6 +985,8 @@ int hbsolver::checkBalance (void) {
 #undef  C_
 #define G_(r,c) (*jg) ((r)*nlfreqs+f,(c)*nlfreqs+f)
 #define C_(r,c) (*jq) ((r)*nlfreqs+f,(c)*nlfreqs+f)
+#define GT_(r,c) (*GT) (((r)*nbanodes+(c))*nlfreqs+f)
+#define CT_(r,c) (*CT) (((r)*nbanodes+(c))*nlfreqs+f)
 #undef  FI_
 #undef  FQ_
 #define FI_(r) (*ig) ((r)*nlfreqs+f)
@@ -931,7 +995,8 @@ int hbsolver::checkBalance (void) {
 #define QR_(r) (*qr) ((r)*nlfreqs+f)
 
 /* This function fills in the matrix and vector entries for the
-   non-linear HB equations for a given frequency index. */
+   non-linear HB equations for a given frequency index.  Without
+   Jacobian matrices the entries go into the compact node blocks. */
 void hbsolver::fillMatrixNonLinear (tmatrix<nr_complex_t> * jg,
 				    tmatrix<nr_complex_t> * jq,
 				    tvector<nr_complex_t> * ig,
@@ -949,8 +1014,14 @@ void hbsolver::fillMatrixNonLinear (tmatrix<nr_complex_t> * jg,
       // apply G- and C-matrix entries
       for (c = 0; c < s; c++) {
 	if ((nc = cir->getNode(c)->getNode () - 1) < 0) continue;
-	G_(nr, nc) += cir->getY (r, c);
-	C_(nr, nc) += cir->getQV (r, c);
+	if (jg != NULL) {
+	  G_(nr, nc) += cir->getY (r, c);
+	  C_(nr, nc) += cir->getQV (r, c);
+	}
+	else {
+	  GT_(nr, nc) += cir->getY (r, c);
+	  CT_(nr, nc) += cir->getQV (r, c);
+	}
       }
       // apply I- and Q-vector entries
       FI_(nr) -= cir->getI (r);
@@ -979,14 +1050,33 @@ void hbsolver::prepareNonLinear (void) {
   if (QR == NULL) {
     QR = new tvector<nr_complex_t> (N * nlfreqs);
   }
-  if (JG == NULL) {
-    JG = new tmatrix<nr_complex_t> (N * nlfreqs);
-  }
-  if (JQ == NULL) {
-    JQ = new tmatrix<nr_complex_t> (N * nlfreqs);
+  if (matrixFree) {
+    // the (time domain) Jacobian consists of node blocks only
+    if (GT == NULL) {
+      GT = new tvector<nr_complex_t> (N * N * nlfreqs);
+    }
+    if (CT == NULL) {
+      CT = new tvector<nr_complex_t> (N * N * nlfreqs);
+    }
+    if (PI == NULL) {
+      PI = new tvector<nr_complex_t> (N * N * nlfreqs);
+    }
+    if (XT == NULL) {
+      XT = new tvector<nr_complex_t> (N * nlfreqs);
+      GX = new tvector<nr_complex_t> (N * nlfreqs);
+      QX = new tvector<nr_complex_t> (N * nlfreqs);
+    }
   }
-  if (JF == NULL) {
-    JF = new tmatrix<nr_complex_t> (N * nlfreqs);
+  else {
+    if (JG == NULL) {
+      JG = new tmatrix<nr_complex_t> (N * nlfreqs);
+    }
+    if (JQ == NULL) {
+      JQ = new tmatrix<nr_complex_t> (N * nlfreqs);
+    }
+    if (JF == NULL) {
+      JF = new tmatrix<nr_complex_t> (N * nlfreqs);
+    }
   }
 
   // voltage vector in frequency and time domain
@@ -1046,8 +1136,14 @@ void hbsolver::loadMatrices (void) {
   FQ->set (0.0);
   IR->set (0.0);
   QR->set (0.0);
-  JG->set (0.0);
-  JQ->set (0.0);
+  if (matrixFree) {
+    GT->set (0.0);
+    CT->set (0.0);
+  }
+  else {
+    JG->set (0.0);
+    JQ->set (0.0);
+  }
   // through each frequency
   for (int f = 0; f < nlfreqs; f++) {
     // calculate components' HB matrices and vector for the given frequency
@@ -1056,7 +1152,10 @@ void hbsolver::loadMatrices (void) {
       cir->calcHB (f);         // HB calculator
     }
     // fill in all matrix entries for the given frequency
-    fillMatrixNonLinear (JG, JQ, IG, FQ, IR, QR, f);
+    if (matrixFree)
+      fillMatrixNonLinear (NULL, NULL, IG, FQ, IR, QR, f);
+    else
+      fillMatrixNonLinear (JG, JQ, IG, FQ, IR, QR, f);
   }
 }
 
@@ -1156,8 +1255,15 @@ void hbsolver::solveHB (void) {
       // part 1 of right hand side vector
       ir -= il;
       // transadmittance matrix multiplied by voltage vector
-      for (int c = 0; c < nbanodes * nlfreqs; c++) {
-	il += YV_(r, c) * VS_(c);
+      if (YB != NULL) {
+	for (int c = 0; c < nbanodes; c++) {
+	  il += YB_(f, r / nlfreqs, c) * VS_(c * nlfreqs + f);
+	}
+      }
+      else {
+	for (int c = 0; c < nbanodes * nlfreqs; c++) {
+	  il += YV_(r, c) * VS_(c);
+	}
       }
       // charge vector
       in += OM_(f) * FQ->get (r);
@@ -1194,6 +1300,147 @@ void hbsolver::calcJacobian (void) {
   *JF += *YV; // add linear admittance matrix
 }
 
+/* The function computes the product y = JF * x of the full Jacobian
+   and the given vector without forming the Jacobian.  The linear
+   admittance matrix [YV] couples equal frequencies only, the
+   non-linear parts are diagonal in the time domain and therefore
+   applied as JG * x = FFT (jg * IFFT (x)) and accordingly for JQ. */
+void hbsolver::multiplyJacobian (void * data, const nr_complex_t * x,
+				 nr_complex_t * y) {
+  hbsolver * hb = (hbsolver *) data;
+  int N = hb->nbanodes, n = hb->nlfreqs;
+  int r, c, f, rt, ct;
+  tvector<nr_complex_t> & xt = *hb->XT, & gt = *hb->GX, & qt = *hb->QX;
+  const nr_complex_t * yb = hb->YB->getData ();
+
+  // linear part [YV] * x
+  for (f = 0; f < n; f++) {
+    for (r = 0; r < N; r++) {
+      nr_complex_t v = 0.0;
+      for (c = 0; c < N; c++) {
+	v += yb[(f * N + r) * N + c] * x[c * n + f];
+      }
+      y[r * n + f] = v;
+    }
+  }
+
+  // non-linear parts in the time domain
+  gt.set (0.0);
+  qt.set (0.0);
+  for (r = 0; r < N * n; r++) xt (r) = x[r];
+  hb->VectorIFFT (&xt);
+  for (r = 0; r < N; r++) {
+    for (c = 0; c < N; c++) {
+      const nr_complex_t * g = hb->GT->getData () + (r * N + c) * n;
+      const nr_complex_t * q = hb->CT->getData () + (r * N + c) * n;
+      for (rt = r * n, ct = c * n, f = 0; f < n; f++, rt++, ct++) {
+	gt (rt) += g[f] * xt (ct);
+	qt (rt) += q[f] * xt (ct);
+      }
+    }
+  }
+  hb->VectorFFT (&gt);
+  hb->VectorFFT (&qt);
+  for (r = 0; r < N * n; r++) {
+    y[r] += gt (r) + qt (r) * hb->OM->get (r % n);
+  }
+}
+
+/* The function computes the inverted diagonal blocks of the
+   preconditioner for the matrix-free solution.  For each frequency
+   the block is [YV] + j[O] * JQ + JG using the time averages of the
+   non-linear Jacobians, i.e. the coupling between different
+   frequencies is neglected. */
+void hbsolver::calcPreconditioner (void) {
+  int N = nbanodes, n = nlfreqs;
+  int r, c, f, t;
+  tmatrix<nr_complex_t> P (N), H (N);
+  tvector<nr_complex_t> x (N), z (N);
+  eqnsys<nr_complex_t> eqns;
+
+  for (f = 0; f < n; f++) {
+    for (r = 0; r < N; r++) {
+      for (c = 0; c < N; c++) {
+	nr_complex_t g = 0.0, q = 0.0;
+	for (t = 0; t < n; t++) {
+	  g += GT->get ((r * N + c) * n + t);
+	  q += CT->get ((r * N + c) * n + t);
+	}
+	P (r, c) = YB_(f, r, c) + (g + q * OM_(f)) / (double) n;
+      }
+    }
+    try_running () {
+      eqns.setAlgo (ALGO_LU_FACTORIZATION_CROUT);
+      eqns.passEquationSys (&P, &x, &z);
+      eqns.solve ();
+      eqns.setAlgo (ALGO_LU_SUBSTITUTION_CROUT);
+      eqns.invert (&H);
+    }
+    catch_exception () {
+    default:
+      // use no preconditioning for singular blocks
+      estack.pop ();
+      H.set (0.0);
+      for (r = 0; r < N; r++) H (r, r) = 1.0;
+    }
+    for (r = 0; r < N; r++) {
+      for (c = 0; c < N; c++) {
+	PI->set ((f * N + r) * N + c, H (r, c));
+      }
+    }
+  }
+}
+
+/* The function forms the full Jacobian JF from the time domain node
+   blocks of the matrix-free solution.  It is used when the GMRES
+   iteration does not converge, the analysis continues with the dense
+   Jacobian afterwards. */
+void hbsolver::denseJacobian (void) {
+  int N = nbanodes, n = nlfreqs;
+  int r, c, f;
+  if (JG == NULL) {
+    JG = new tmatrix<nr_complex_t> (N * n);
+    JQ = new tmatrix<nr_complex_t> (N * n);
+    JF = new tmatrix<nr_complex_t> (N * n);
+  }
+  if (YV == NULL) {
+    YV = new tmatrix<nr_complex_t> (N * n);
+  }
+  JG->set (0.0);
+  JQ->set (0.0);
+  for (r = 0; r < N; r++) {
+    for (c = 0; c < N; c++) {
+      for (f = 0; f < n; f++) {
+	(*JG) (r * n + f, c * n + f) = GT->get ((r * N + c) * n + f);
+	(*JQ) (r * n + f, c * n + f) = CT->get ((r * N + c) * n + f);
+	(*YV) (r * n + f, c * n + f) = YB_(f, r, c);
+      }
+    }
+  }
+  MatrixFFT (JG);
+  MatrixFFT (JQ);
+  calcJacobian ();
+  matrixFree = 0;
+}
+
+/* The function applies the block diagonal preconditioner computed
+   above, i.e. y = P^-1 * x for each frequency. */
+void hbsolver::applyPreconditioner (void * data, const nr_complex_t * x,
+				    nr_complex_t * y) {
+  hbsolver * hb = (hbsolver *) data;
+  int N = hb->nbanodes, n = hb->nlfreqs;
+  const nr_complex_t * p = hb->PI->getData ();
+  for (int f = 0; f < n; f++) {
+    for (int r = 0; r < N; r++) {
+      nr_complex_t v = 0.0;
+      for (int c = 0; c < N; c++) {
+	v += p[(f * N + r) * N + c] * x[c * n + f];
+      }
+      y[r * n + f] = v;
+    }
+  }
+}
+
 /* The function expands the given vector in the frequency domain to
    make it a real valued signal in the time domain. */
 tvector<nr_complex_t> hbsolver::expandVector (tvector<nr_complex_t> V,
@@ -1240,6 +1487,32 @@ tmatrix<nr_complex_t> hbsolver::expandMatrix (tmatrix<nr_complex_t> M,
   return res;
 }
 
+/* The function extracts the blocks of equal frequencies of the
+   transadmittance matrix as returned by expandMatrix(), i.e. the
+   blocks of the conjugately continued frequencies are conjugated.
+   The block of frequency f holds the entry of row r and column c at
+   index (f * nodes + r) * nodes + c. */
+tvector<nr_complex_t> hbsolver::expandBlocks (const tmatrix<nr_complex_t> & M,
+					      int nodes) {
+  tvector<nr_complex_t> res (nodes * nodes * nlfreqs);
+  int r, c, f;
+  for (f = 0; f < nlfreqs; f++) {
+    for (r = 0; r < nodes; r++) {
+      for (c = 0; c < nodes; c++) {
+	int i = (f * nodes + r) * nodes + c;
+	if (f < lnfreqs) {
+	  res (i) = M (r * lnfreqs + f, c * lnfreqs + f);
+	}
+	else {
+	  int ff = 2 * lnfreqs - 2 - f;
+	  res (i) = conj (M (r * lnfreqs + ff, c * lnfreqs + ff));
+	}
+      }
+    }
+  }
+  return res;
+}
+
 /* This function solves the equation system
    JF * VS(n+1) = JF * VS(n) - FV
    in order to obtains a new voltage vector in the frequency domain. */
@@ -1249,14 +1522,41 @@ void hbsolver::solveVoltages (void) {
 
   // setup equation system
   eqnsys<nr_complex_t> eqns;
+  eqns.setThreads (threads);
   try_running () {
     // use LU decomposition for solving
-    eqns.setAlgo (ALGO_LU_DECOMPOSITION);
-    eqns.passEquationSys (JF, VS, RH);
+    if (matrixFree) {
+      // iterate using the Jacobian operator instead of the matrix
+      eqns.setAlgo (ALGO_GMRES);
+      eqns.passEquationSys (multiplyJacobian, applyPreconditioner, this,
+			    VS, RH);
+    }
+    else {
+      eqns.setAlgo (threads > 1 ? ALGO_LU_DECOMPOSITION_BLOCKED :
+		    ALGO_LU_DECOMPOSITION);
+      eqns.passEquationSys (JF, VS, RH);
+    }
     eqns.solve ();
+    if (matrixFree) {
+      logprint (LOG_STATUS, "NOTIFY: %s: %d GMRES iterations, "
+		"residual %g\n", getName (), eqns.getIterations (),
+		eqns.getResidual ());
+    }
   }
   // appropriate exception handling
   catch_exception () {
+  case EXCEPTION_NO_CONVERGENCE:
+    if (matrixFree) {
+      // retry using the dense Jacobian
+      pop_exception ();
+      logprint (LOG_ERROR, "WARNING: %s: no GMRES convergence, using the "
+		"dense Jacobian\n", getName ());
+      *VS = *VP;
+      denseJacobian ();
+      solveVoltages ();
+      return;
+    }
+    // fall through
   default:
     logprint (LOG_ERROR, "WARNING: %s: during NR iteration\n", getName ());
     estack.print ();
@@ -1393,6 +1693,8 @@ PROP_OPT [] = {
   { "vabstol", PROP_REAL, { 1e-6, PROP_NO_STR }, PROP_RNG_X01I },
   { "reltol", PROP_REAL, { 1e-3, PROP_NO_STR }, PROP_RNG_X01I },
   { "MaxIter", PROP_INT, { 150, PROP_NO_STR }, PROP_RNGII (2, 10000) },
+  { "Threads", PROP_INT, { 1, PROP_NO_STR }, PROP_RNGII (1, 256) },
+  { "Solver", PROP_STR, { PROP_NO_VAL, "LU" }, PROP_RNG_STR2 ("LU", "GMRES") },
   PROP_NO_PROP };
 struct define_t hbsolver::anadef =
   { "HB", 0, PROP_ACTION, PROP_NO_SUBSTRATE, PROP_LINEAR, PROP_DEF };
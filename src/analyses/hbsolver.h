@@ -24,6 +24,7 @@
 
 #include <vector>
 
+#include "continuation.h"
 #include "ptrlist.h"
 #include "tvector.h"
 
@@ -40,6 +41,7 @@ public:
   hbsolver(const hbsolver &) = delete;
   ~hbsolver() override;
   int solve() override;
+  void setContinuation(double, bool) override;
   void initHB();
   void initDC();
   static void calc(hbsolver *);
@@ -73,9 +75,14 @@ public:
   int calcOrder(int);
   void MatrixFFT(tmatrix<nr_complex_t> *);
   void calcJacobian();
+  void calcPreconditioner();
+  void denseJacobian();
+  static void multiplyJacobian(void *, const nr_complex_t *, nr_complex_t *);
+  static void applyPreconditioner(void *, const nr_complex_t *, nr_complex_t *);
   void solveVoltages();
   tvector<nr_complex_t> expandVector(tvector<nr_complex_t>, int);
   tmatrix<nr_complex_t> expandMatrix(tmatrix<nr_complex_t>, int);
+  tvector<nr_complex_t> expandBlocks(const tmatrix<nr_complex_t> &, int);
   tmatrix<nr_complex_t> extendMatrixLinear(tmatrix<nr_complex_t>, int);
   void fillMatrixLinearExtended(tmatrix<nr_complex_t> *, tvector<nr_complex_t> *);
   void saveNodeVoltages(circuit *, int);
@@ -97,11 +104,16 @@ private:
   tmatrix<nr_complex_t> *Z; // transimpedance matrix of linear network
 
   tmatrix<nr_complex_t> *YV; // linear transadmittance matrix
+  tvector<nr_complex_t> *YB; // linear transadmittance blocks in f (matrix-free)
   tmatrix<nr_complex_t> *NA; // MNA-matrix of complete network
 
   tmatrix<nr_complex_t> *JQ; // C-Jacobian in t and f
   tmatrix<nr_complex_t> *JG; // G-Jacobian in t and f
   tmatrix<nr_complex_t> *JF; // full Jacobian for non-linear balancing
+  tvector<nr_complex_t> *GT; // G-Jacobian node blocks in t (matrix-free)
+  tvector<nr_complex_t> *CT; // C-Jacobian node blocks in t (matrix-free)
+  tvector<nr_complex_t> *PI; // inverted preconditioner blocks in f
+  tvector<nr_complex_t> *XT, *GX, *QX; // temporaries of the Jacobian product
   tvector<nr_complex_t> *IG; // currents in t and f
   tvector<nr_complex_t> *FQ; // charges in t and f
   tvector<nr_complex_t> *VS;
@@ -120,7 +132,13 @@ private:
   tvector<nr_complex_t> *x;
   tvector<nr_complex_t> *vs;
 
-  int runs;
+  // voltages of the previous parameter sweep points in f and t
+  continuation<nr_complex_t> contVS;
+  continuation<nr_complex_t> contvs;
+  double contParam;
+  int contEnabled;
+  int contPending;
+
   int lnfreqs;
   int nlfreqs;
   int nnlvsrcs;
@@ -129,6 +147,8 @@ private:
   int nnanodes;
   int nexnodes;
   int nbanodes;
+  int threads; // number of threads used by the LU decompositions
+  int matrixFree; // solve for the voltages without forming the Jacobian
 };
 
 } // namespace qucs
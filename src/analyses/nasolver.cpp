@@ -19,6 +19,7 @@
  * Boston, MA 02110-1301, USA.
  */
 
+#include <algorithm>
 #include <cstring>
 
 #include "analysis.h"
@@ -42,39 +43,69 @@ namespace qucs {
 
 template <class nr_type_t> nasolver<nr_type_t>::nasolver() : analysis() {
   nlist = nullptr;
-  A = C = nullptr;
+  A = nullptr;
+  As = nullptr;
   z = x = xprev = zprev = nullptr;
   reltol = abstol = vntol = 0;
+  krylovTol = 1e-12;
+  krylovMaxIter = 0;
   calculate_func = nullptr;
   convHelper = 0;
   eqnAlgo = ALGO_LU_DECOMPOSITION;
   updateMatrix = 1;
+  bypass = bypassed = 0;
+  condense = 0;
+  ordering = ORDERING_NONE;
+  Aii = nullptr;
+  eqnsInner = nullptr;
+  Wcond = nullptr;
+  reuseMax = factorizations = 0;
+  reuseCount = -1;
+  residualPrev = 0;
   gMin = srcFactor = 0;
+  contParam = 0;
+  contEnabled = contPending = false;
   eqns = new eqnsys<nr_type_t>();
 }
 
 template <class nr_type_t> nasolver<nr_type_t>::nasolver(const std::string &n) : analysis(n) {
   nlist = nullptr;
-  A = C = nullptr;
+  A = nullptr;
+  As = nullptr;
   z = x = xprev = zprev = nullptr;
   reltol = abstol = vntol = 0;
+  krylovTol = 1e-12;
+  krylovMaxIter = 0;
   calculate_func = nullptr;
   convHelper = 0;
   eqnAlgo = ALGO_LU_DECOMPOSITION;
   updateMatrix = 1;
+  bypass = bypassed = 0;
+  condense = 0;
+  ordering = ORDERING_NONE;
+  Aii = nullptr;
+  eqnsInner = nullptr;
+  Wcond = nullptr;
+  reuseMax = factorizations = 0;
+  reuseCount = -1;
+  residualPrev = 0;
   gMin = srcFactor = 0;
+  contParam = 0;
+  contEnabled = contPending = false;
   eqns = new eqnsys<nr_type_t>();
 }
 
 template <class nr_type_t> nasolver<nr_type_t>::~nasolver() {
   delete nlist;
-  delete C;
   delete A;
+  delete As;
   delete z;
   delete x;
   delete xprev;
   delete zprev;
   delete eqns;
+  clearCondensation();
+  clearFactorCache();
 }
 
 /* Creates the list of nodes.
@@ -87,6 +118,7 @@ template <class nr_type_t> void nasolver<nr_type_t>::solve_pre() {
 
   nlist = new nodelist(subnet);
   nlist->assignNodes();
+  nlist->orderNodes(ordering);
   nlist->print();
   assignVoltageSources(); // ARA: Count the number of nodes and branches, assign unique indices to
                           // voltage sources.
@@ -96,7 +128,20 @@ template <class nr_type_t> void nasolver<nr_type_t>::solve_pre() {
   const int N = countNodes();          // ARA: same as nlist->length() - 1
 
   delete A;
-  A = new tmatrix<nr_type_t>(M + N);
+  delete As;
+  A = nullptr;
+  As = nullptr;
+  stamps.clear();
+  if ((eqnAlgo & ALGO_LU_DECOMPOSITION_SPARSE) == ALGO_LU_DECOMPOSITION_SPARSE ||
+      eqnAlgo == ALGO_GMRES || eqnAlgo == ALGO_BICGSTAB) {
+    // only the non-zero structure of the sparse matrix is stored
+    As = new tspmatrix<nr_type_t>(M + N);
+    // the structure never changes during the analysis, thus the pivot
+    // order of the first decomposition can be reused by the following ones
+    eqns->setReuse(1);
+  } else {
+    A = new tmatrix<nr_type_t>(M + N);
+  }
   delete z;
   z = new tvector<nr_type_t>(M + N);
   delete x;
@@ -110,6 +155,100 @@ template <class nr_type_t> void nasolver<nr_type_t>::solve_pre() {
 template <class nr_type_t> void nasolver<nr_type_t>::solve_post() {
   delete nlist;
   nlist = nullptr;
+  stamps.clear();
+  bypassState.clear();
+  clearCondensation();
+  clearFactorCache();
+}
+
+/* Selects the node ordering by the name given in the "Ordering"
+ * property of the analysis. */
+template <class nr_type_t> void nasolver<nr_type_t>::setOrdering(const char *const name) {
+  if (!strcmp(name, "RCM"))
+    ordering = ORDERING_RCM;
+  else if (!strcmp(name, "MinDegree"))
+    ordering = ORDERING_MINDEGREE;
+  else
+    ordering = ORDERING_NONE;
+}
+
+/* Returns the algorithm factorizing the MNA matrix matching the given
+ * decomposition algorithm of the analysis and the one substituting with
+ * these factors, e.g. for the adjoint systems of the noise analyses.
+ * Sparse matrices (also used by the Krylov solvers) are factorized by
+ * the sparse LU decomposition. */
+template <class nr_type_t> int nasolver<nr_type_t>::factorizationAlgo(int algo) {
+  if (isSparse())
+    return ALGO_LU_FACTORIZATION_SPARSE;
+  else if (algo == ALGO_LU_DECOMPOSITION_BLOCKED)
+    return ALGO_LU_FACTORIZATION_BLOCKED;
+  else if (algo == ALGO_LU_DECOMPOSITION_MIXED)
+    return ALGO_LU_FACTORIZATION_MIXED;
+  return ALGO_LU_FACTORIZATION_CROUT;
+}
+
+template <class nr_type_t> int nasolver<nr_type_t>::substitutionAlgo(int algo) {
+  if (isSparse())
+    return ALGO_LU_SUBSTITUTION_SPARSE;
+  else if (algo == ALGO_LU_DECOMPOSITION_BLOCKED)
+    return ALGO_LU_SUBSTITUTION_DOOLITTLE;
+  else if (algo == ALGO_LU_DECOMPOSITION_MIXED)
+    return ALGO_LU_SUBSTITUTION_MIXED;
+  return ALGO_LU_SUBSTITUTION_CROUT;
+}
+
+/* Device bypass.  The function is run before the evaluation of each
+ * circuit during the Newton iteration and returns true if the
+ * evaluation can be skipped, i.e. its matrix and vector entries from
+ * the last evaluation be reused as they are.  This requires that
+ * - the node voltages moved less than the convergence tolerances
+ *   since the last evaluation,
+ * - the change of the port currents predicted by the Jacobian is
+ *   within the current tolerances and
+ * - the last evaluation itself agreed with the linearization of the
+ *   evaluation before, otherwise the circuit might still be limiting
+ *   its voltages.
+ * Circuits with voltage sources (depending on branch currents) are
+ * always evaluated. */
+template <class nr_type_t> bool nasolver<nr_type_t>::bypassCircuit(circuit *c) {
+  if (!bypass || !c->isNonLinear() || c->getVoltageSources() > 0)
+    return false;
+  const int s = c->getSize();
+  bypass_t &b = bypassState[c];
+  bool skip = b.evals >= 2;
+  for (int i = 0; skip && i < s; i++) {
+    const double u = real(c->getV(i));
+    skip = std::fabs(u - b.V[i]) < vntol + reltol * std::max(std::fabs(u), std::fabs(b.V[i]));
+  }
+  for (int r = 0; skip && r < s; r++) {
+    // port current at the last evaluation, its predicted change and
+    // the current predicted by the evaluation before
+    double i = -real(c->getI(r)), di = 0, ip = -b.I[r];
+    for (int k = 0; k < s; k++) {
+      const double y = real(c->getY(r, k));
+      i += y * b.V[k];
+      di += y * (real(c->getV(k)) - b.V[k]);
+      ip += b.Y[r * s + k] * b.V[k];
+    }
+    const double tol = abstol + reltol * std::max(std::fabs(i), std::fabs(i + di));
+    skip = std::fabs(di) < tol && std::fabs(i - ip) < tol;
+  }
+  if (skip) {
+    bypassed++;
+    return true;
+  }
+  // keep the entries of the last evaluation and the new voltages
+  b.V.resize(s);
+  b.Y.resize(s * s);
+  b.I.resize(s);
+  for (int r = 0; r < s; r++) {
+    b.V[r] = real(c->getV(r));
+    b.I[r] = real(c->getI(r));
+    for (int k = 0; k < s; k++)
+      b.Y[r * s + k] = real(c->getY(r, k));
+  }
+  b.evals++;
+  return false;
 }
 
 /* Runs the nodal analysis solver once, reports errors if any
@@ -123,12 +262,20 @@ template <class nr_type_t> int nasolver<nr_type_t>::solve_once() {
   // ARA: Circuits update their internal matrices and vectors.
   calculate();
 
-  // generate matrix `A` and vector `z`
-  // ARA: Read circuit internal matrices and vectors such as MatrixY, VectorI.
-  createMatrix();
+  if (condenseLinear()) {
+    // solve the reduced system and the inner rows of the linear subnetwork
+    solveCondensed();
+  } else if (reuseFactors()) {
+    // modified Newton step using the LU factors of an earlier iteration
+    solveCorrection();
+  } else {
+    // generate matrix `A` and vector `z`
+    // ARA: Read circuit internal matrices and vectors such as MatrixY, VectorI.
+    createMatrix();
 
-  // solve the system of linear equations
-  solveLinearEquations();
+    // solve the system of linear equations
+    solveLinearEquations();
+  }
 
   if (estack.top()) {
     estack.print();
@@ -152,6 +299,94 @@ template <class nr_type_t> int nasolver<nr_type_t>::solve_linear() {
   return solve_once();
 }
 
+/* The linear nodal analysis netlist solver for a sequence of matrices
+ * taking a few distinct values only, e.g. in the transient analysis
+ * of a linear netlist where the companion models of the reactive
+ * circuits change with the step size and integration order only.  The
+ * LU factors of the latest matrices are cached.  The matrix is still
+ * assembled since some linear circuits change their entries with time,
+ * but it is factorized only if its entries differ from all cached
+ * ones, otherwise the solution takes a forward and backward
+ * substitution.  The key given by the caller, e.g. the step size, just
+ * skips the comparison of the entries for cached matrices of another
+ * key; a match always requires all entries to be equal. */
+template <class nr_type_t> int nasolver<nr_type_t>::solve_linear_cached(double key) {
+  switch (eqnAlgo) {
+  case ALGO_LU_DECOMPOSITION_CROUT:
+  case ALGO_LU_DECOMPOSITION_DOOLITTLE:
+  case ALGO_LU_DECOMPOSITION_BLOCKED:
+  case ALGO_LU_DECOMPOSITION_MIXED:
+  case ALGO_LU_DECOMPOSITION_SPARSE:
+    break;
+  default:
+    return solve_linear();
+  }
+
+  logprint(LOG_STATUS, "NOTIFY: %s: nasolver::solve_linear_cached()\n", getName());
+
+  log_indent();
+
+  calculate();
+  updateMatrix = 1;
+  createMatrix();
+
+  const nr_type_t *data = isSparse() ? As->getData() : A->getData();
+  const int size = isSparse() ? As->getNonZeros() : A->getRows() * A->getCols();
+  auto f = std::find_if(factorCache.begin(), factorCache.end(), [&](const factors_t &e) {
+    return e.key == key && std::equal(e.entries.begin(), e.entries.end(), data);
+  });
+  if (f != factorCache.end()) {
+    // substitute with the cached factors and move them to the front
+    std::rotate(factorCache.begin(), f, f + 1);
+    eqnsys<nr_type_t> *e = factorCache.front().eqns;
+    e->passEquationSys((tmatrix<nr_type_t> *)nullptr, x, z);
+    e->solve();
+  } else {
+    // factorize a copy of the matrix
+    factors_t e;
+    e.key = key;
+    e.entries.assign(data, data + size);
+    e.A = isSparse() ? nullptr : new tmatrix<nr_type_t>(*A);
+    e.As = isSparse() ? new tspmatrix<nr_type_t>(*As) : nullptr;
+    e.eqns = new eqnsys<nr_type_t>();
+    e.eqns->setAlgo(eqnAlgo);
+    if (isSparse()) {
+      e.eqns->setReuse(1);
+      e.eqns->passEquationSys(e.As, x, z);
+    } else {
+      e.eqns->passEquationSys(e.A, x, z);
+    }
+    e.eqns->solve();
+    factorizations++;
+    if (estack.top()) {
+      // do not keep the factors of a singular matrix
+      delete e.A;
+      delete e.As;
+      delete e.eqns;
+    } else {
+      // replace the least recently used factors
+      if (factorCache.size() >= NA_FACTOR_CACHE) {
+        delete factorCache.back().A;
+        delete factorCache.back().As;
+        delete factorCache.back().eqns;
+        factorCache.pop_back();
+      }
+      factorCache.insert(factorCache.begin(), e);
+    }
+  }
+
+  if (estack.top()) {
+    estack.print();
+    return estack.top()->getCode();
+  }
+
+  saveSolution();
+
+  log_dedent();
+
+  return NO_ERROR;
+}
+
 /* The non-linear iterative nodal analysis netlist solver. */
 template <class nr_type_t> int nasolver<nr_type_t>::solve_nonlinear() {
   const int MaxIter = getPropertyInteger("MaxIter");
@@ -159,6 +394,10 @@ template <class nr_type_t> int nasolver<nr_type_t>::solve_nonlinear() {
   abstol = getPropertyDouble("abstol");
   vntol = getPropertyDouble("vntol");
 
+  // the first iteration evaluates all circuits and factorizes the matrix
+  bypassState.clear();
+  reuseCount = -1;
+
   if (convHelper == CONV_GMinStepping) {
     // use the alternative non-linear solver solve_nonlinear_continuation_gMin
     // instead of the basic solver provided by this function
@@ -329,10 +568,10 @@ template <class nr_type_t> void nasolver<nr_type_t>::createMatrix() {
                               +-   -+.
      Each of these minor matrices is going to be generated here. */
   if (updateMatrix) {
-    createGMatrix();
-    createBMatrix();
-    createCMatrix();
-    createDMatrix();
+    if (stamps.empty()) {
+      createStampMap();
+    }
+    createAMatrix();
   }
 
   /* Adjust G matrix if requested. */
@@ -340,7 +579,11 @@ template <class nr_type_t> void nasolver<nr_type_t>::createMatrix() {
     const int N = countNodes();
     const int M = countVoltageSources();
     for (int n = 0; n < N + M; n++) {
-      A->set(n, n, A->get(n, n) + gMin);
+      if (isSparse()) {
+        As->add(n, n, gMin);
+      } else {
+        A->set(n, n, A->get(n, n) + gMin);
+      }
     }
   }
 
@@ -365,211 +608,290 @@ template <class nr_type_t> nr_type_t nasolver<nr_type_t>::MatValX(nr_complex_t z
   return real(z);
 }
 
-/* The G matrix is an NxN matrix formed in two steps.
-   1. Each element in the diagonal matrix is equal to the sum of the
-   conductance of each element connected to the corresponding node.
-   2. The off diagonal elements are the negative conductance of the
-   element connected to the pair of corresponding nodes.  Therefore a
-   resistor between nodes 1 and 2 goes into the G matrix at location
-   (1,2) and location (2,1).  If an element is grounded, it will only
-   have contribute to one entry in the G matrix -- at the appropriate
-   location on the diagonal. */
-template <class nr_type_t> void nasolver<nr_type_t>::createGMatrix() {
+/* The entries of the circuit's MNA matrices and vectors.  Circuits using
+ * real-valued storage (DC and transient analyses) are read directly as
+ * doubles, all others are converted from their complex values. */
+template <class nr_type_t>
+inline nr_type_t nasolver<nr_type_t>::entryY(circuit *c, int r, int k) {
+  return c->isRealMNA() ? nr_type_t(c->getRealY(r, k)) : MatVal(c->getY(r, k));
+}
+
+template <class nr_type_t>
+inline nr_type_t nasolver<nr_type_t>::entryB(circuit *c, int p, int k) {
+  return c->isRealMNA() ? nr_type_t(c->getRealB(p, k)) : MatVal(c->getB(p, k));
+}
+
+template <class nr_type_t>
+inline nr_type_t nasolver<nr_type_t>::entryC(circuit *c, int k, int p) {
+  return c->isRealMNA() ? nr_type_t(c->getRealC(k, p)) : MatVal(c->getC(k, p));
+}
+
+template <class nr_type_t>
+inline nr_type_t nasolver<nr_type_t>::entryD(circuit *c, int k, int l) {
+  return c->isRealMNA() ? nr_type_t(c->getRealD(k, l)) : MatVal(c->getD(k, l));
+}
+
+template <class nr_type_t> inline nr_type_t nasolver<nr_type_t>::entryE(circuit *c, int k) {
+  return c->isRealMNA() ? nr_type_t(c->getRealE(k)) : MatVal(c->getE(k));
+}
+
+template <class nr_type_t> inline nr_type_t nasolver<nr_type_t>::entryI(circuit *c, int port) {
+  return c->isRealMNA() ? nr_type_t(c->getRealI(port)) : MatVal(c->getI(port));
+}
+
+/* Builds the stamp map of the MNA matrix.  For each entry of the Y, B, C
+ * and D matrices of each circuit the function determines its destination
+ * slot inside the data of the A matrix once, thus the matrix can be
+ * assembled by a single pass over the circuit list afterwards.  If the
+ * sparse solver is used the non-zero structure of the matrix is set up
+ * here as well.  It consists of all port pairs of each circuit, the B, C
+ * and D entries of their voltage sources and the diagonal which may be
+ * used by gMin stepping or the solver itself. */
+template <class nr_type_t> void nasolver<nr_type_t>::createStampMap() {
   const int N = countNodes();
-  // go through each column of the G matrix
-  for (int c = 0; c < N; c++) {
-    struct nodelist_t *nc = nlist->getNode(c);
-    // go through each row of the G matrix
-    for (int r = 0; r < N; r++) {
-      struct nodelist_t *nr = nlist->getNode(r);
-      nr_type_t g = 0.0;
-      // sum up the conductance of each connected circuit
-      for (auto &currentnc : *nc) {
-        for (auto &currentnr : *nr) {
-          if (currentnc->getCircuit() == currentnr->getCircuit()) {
-            circuit *ct = currentnc->getCircuit();
-            const int pc = currentnc->getPort();
-            const int pr = currentnr->getPort();
-            g += MatVal(ct->getY(pr, pc));
-          }
+  const int M = countVoltageSources();
+
+  // find the MNA matrix row of each circuit port, -1 for the reference node
+  std::unordered_map<circuit *, std::vector<int>> rows;
+  for (circuit *c = subnet->getRoot(); c != nullptr; c = c->getNext()) {
+    rows[c].assign(c->getSize(), -1);
+  }
+  for (int r = 0; r < N; r++) {
+    struct nodelist_t *n = nlist->getNode(r);
+    for (auto &current : *n) {
+      rows[current->getCircuit()][current->getPort()] = r;
+    }
+  }
+
+  // put all the entries which can become non-zero into the sparse structure
+  if (isSparse() && !As->isCompressed()) {
+    for (int r = 0; r < N + M; r++) {
+      As->insert(r, r);
+    }
+    for (circuit *c = subnet->getRoot(); c != nullptr; c = c->getNext()) {
+      const std::vector<int> &row = rows[c];
+      const int vs = N + c->getVoltageSource();
+      for (int pr = 0; pr < c->getSize(); pr++) {
+        if (row[pr] < 0)
+          continue;
+        for (int pc = 0; pc < c->getSize(); pc++) {
+          if (row[pc] >= 0)
+            As->insert(row[pr], row[pc]);
+        }
+        for (int k = 0; k < c->getVoltageSources(); k++) {
+          As->insert(row[pr], vs + k);
+          As->insert(vs + k, row[pr]);
+        }
+      }
+      for (int k = 0; k < c->getVoltageSources(); k++) {
+        for (int l = 0; l < c->getVoltageSources(); l++) {
+          As->insert(vs + k, vs + l);
         }
       }
-      // put value into G matrix
-      A->set(r, c, g);
     }
+    As->compress();
+    logprint(LOG_STATUS, "NOTIFY: %s: sparse %dx%d matrix with %d non-zeros\n", getName(),
+             N + M, N + M, As->getNonZeros());
   }
-}
 
-/* The B matrix is an MxN matrix with only 0, 1 and -1 elements.  Each
-   location in the matrix corresponds to a particular voltage source
-   (first dimension) or a node (second dimension).  If the positive
-   terminal of the ith voltage source is connected to node k, then the
-   element (i,k) in the B matrix is a 1.  If the negative terminal of
-   the ith voltage source is connected to node k, then the element
-   (i,k) in the B matrix is a -1.  Otherwise, elements of the B matrix
-   are zero. */
-template <class nr_type_t> void nasolver<nr_type_t>::createBMatrix() {
-  const int N = countNodes();
-  const int M = countVoltageSources();
-  // go through each voltage sources (first dimension)
-  for (int c = 0; c < M; c++) {
-    circuit *vs = findVoltageSource(c);
-    // go through each node (second dimension)
-    for (int r = 0; r < N; r++) {
-      nr_type_t val = 0.0;
-      struct nodelist_t *n = nlist->getNode(r);
-      for (auto &current : *n) {
-        // is voltage source connected to node ?
-        if (current->getCircuit() == vs) {
-          val += MatVal(vs->getB(current->getPort(), c));
-        }
+  // returns the destination slot of the given matrix entry
+  auto slot = [&](int r, int c) -> int {
+    if (r < 0 || c < 0)
+      return -1;
+    return isSparse() ? As->find(r, c) : r * (N + M) + c;
+  };
+
+  stamps.clear();
+  for (circuit *c = subnet->getRoot(); c != nullptr; c = c->getNext()) {
+    const std::vector<int> &row = rows[c];
+    const int size = c->getSize();
+    const int vs = N + c->getVoltageSource();
+    const int vsources = c->getVoltageSources();
+    stamp_t s;
+    s.c = c;
+    s.R = row;
+    for (int pr = 0; pr < size; pr++) {
+      for (int pc = 0; pc < size; pc++) {
+        s.Y.push_back(slot(row[pr], row[pc]));
       }
-      // put value into B matrix
-      A->set(r, c + N, val);
     }
+    for (int p = 0; p < size; p++) {
+      for (int k = 0; k < vsources; k++) {
+        s.B.push_back(slot(row[p], vs + k));
+      }
+    }
+    for (int k = 0; k < vsources; k++) {
+      for (int p = 0; p < size; p++) {
+        s.C.push_back(slot(vs + k, row[p]));
+      }
+    }
+    for (int k = 0; k < vsources; k++) {
+      for (int l = 0; l < vsources; l++) {
+        s.D.push_back(slot(vs + k, vs + l));
+      }
+    }
+    stamps.push_back(std::move(s));
   }
 }
 
-/* The C matrix is an NxM matrix with only 0, 1 and -1 elements.  Each
-   location in the matrix corresponds to a particular node (first
-   dimension) or a voltage source (first dimension).  If the positive
-   terminal of the ith voltage source is connected to node k, then the
-   element (k,i) in the C matrix is a 1.  If the negative terminal of
-   the ith voltage source is connected to node k, then the element
-   (k,i) in the C matrix is a -1.  Otherwise, elements of the C matrix
-   are zero. */
-template <class nr_type_t> void nasolver<nr_type_t>::createCMatrix() {
+/* Runs the given function for each entry of the A matrix as provided
+ * by the circuits, i.e. with the MNA row and column and the value of
+ * each entry of their Y matrices and the B, C and D entries of their
+ * voltage sources.  Entries belonging to the reference node are left
+ * out.  The stamp map must have been created before. */
+template <class nr_type_t>
+template <class F>
+void nasolver<nr_type_t>::forEachEntry(F f) {
   const int N = countNodes();
-  const int M = countVoltageSources();
-  // go through each voltage sources (second dimension)
-  for (int r = 0; r < M; r++) {
-    circuit *vs = findVoltageSource(r);
-    // go through each node (first dimension)
-    for (int c = 0; c < N; c++) {
-      nr_type_t val = 0.0;
-      struct nodelist_t *n = nlist->getNode(c);
-      for (auto &current : *n) {
-        // is voltage source connected to node ?
-        if (current->getCircuit() == vs) {
-          val += MatVal(vs->getC(r, current->getPort()));
-        }
+  for (const stamp_t &s : stamps) {
+    circuit *c = s.c;
+    const int size = c->getSize();
+    const int vs = c->getVoltageSource();
+    const int vsources = c->getVoltageSources();
+    for (int pr = 0; pr < size; pr++) {
+      if (s.R[pr] < 0)
+        continue;
+      for (int pc = 0; pc < size; pc++) {
+        if (s.R[pc] >= 0)
+          f(c, s.R[pr], s.R[pc], entryY(c, pr, pc));
+      }
+    }
+    for (int p = 0; p < size; p++) {
+      if (s.R[p] < 0)
+        continue;
+      for (int k = vs; k < vs + vsources; k++) {
+        f(c, s.R[p], N + k, entryB(c, p, k));
+        f(c, N + k, s.R[p], entryC(c, k, p));
+      }
+    }
+    for (int k = vs; k < vs + vsources; k++) {
+      for (int l = vs; l < vs + vsources; l++) {
+        f(c, N + k, N + l, entryD(c, k, l));
       }
-      // put value into C matrix
-      A->set(r + N, c, val);
     }
   }
 }
 
-/* The D matrix is an MxM matrix that is composed entirely of zeros.
-   It can be non-zero if dependent sources are considered. */
-template <class nr_type_t> void nasolver<nr_type_t>::createDMatrix() {
-  const int M = countVoltageSources();
-  const int N = countNodes();
-  for (int r = 0; r < M; r++) {
-    circuit *vsr = findVoltageSource(r);
-    for (int c = 0; c < M; c++) {
-      circuit *vsc = findVoltageSource(c);
-      nr_type_t val = 0.0;
-      if (vsr == vsc) {
-        val = MatVal(vsr->getD(r, c));
+/* Generates the A matrix from the stamp map.  Each circuit adds the
+ * entries of its Y matrix (the conductances forming the G matrix) and
+ * the B, C and D entries of its voltage sources into place.  Entries of
+ * several circuits connected to the same pair of nodes are summed up. */
+template <class nr_type_t> void nasolver<nr_type_t>::createAMatrix() {
+  nr_type_t *data;
+  if (isSparse()) {
+    As->set(0.0);
+    data = As->getData();
+  } else {
+    A->set(0.0);
+    data = A->getData();
+  }
+  for (const stamp_t &s : stamps) {
+    circuit *c = s.c;
+    const int size = c->getSize();
+    const int vs = c->getVoltageSource();
+    const int vsources = c->getVoltageSources();
+    const int *slot = s.Y.data();
+    for (int pr = 0; pr < size; pr++) {
+      for (int pc = 0; pc < size; pc++, slot++) {
+        if (*slot >= 0)
+          data[*slot] += entryY(c, pr, pc);
+      }
+    }
+    slot = s.B.data();
+    for (int p = 0; p < size; p++) {
+      for (int k = vs; k < vs + vsources; k++, slot++) {
+        if (*slot >= 0)
+          data[*slot] += entryB(c, p, k);
+      }
+    }
+    slot = s.C.data();
+    for (int k = vs; k < vs + vsources; k++) {
+      for (int p = 0; p < size; p++, slot++) {
+        if (*slot >= 0)
+          data[*slot] += entryC(c, k, p);
+      }
+    }
+    slot = s.D.data();
+    for (int k = vs; k < vs + vsources; k++) {
+      for (int l = vs; l < vs + vsources; l++, slot++) {
+        data[*slot] += entryD(c, k, l);
       }
-      A->set(r + N, c + N, val);
     }
   }
 }
 
-/* Creates the (N+M)x(N+M) noise current correlation matrix
- * used during the AC noise computations. */
-template <class nr_type_t> void nasolver<nr_type_t>::createNoiseMatrix() {
-  const int N = countNodes();
-  const int M = countVoltageSources();
+/* Transposes the left hand side matrix, e.g. for the adjoint systems of
+ * the noise analysis. */
+template <class nr_type_t> void nasolver<nr_type_t>::transposeMatrix() {
+  if (isSparse()) {
+    As->transpose();
+  } else {
+    A->transpose();
+  }
+}
 
-  // create new Cy matrix if necessary
-  delete C;
-  C = new tmatrix<nr_type_t>(N + M);
+/* Checks the left hand side matrix for non-finite values. */
+template <class nr_type_t> bool nasolver<nr_type_t>::isMatrixFinite() {
+  return isSparse() ? As->isFinite() : A->isFinite();
+}
 
-  // go through each column of the Cy matrix
-  for (int c = 0; c < N; c++) {
-    struct nodelist_t *nc = nlist->getNode(c);
-    // go through each row of the Cy matrix
-    for (int r = 0; r < N; r++) {
-      struct nodelist_t *nr = nlist->getNode(r);
-      nr_type_t val = 0.0;
-      // sum up the noise-correlation of each connected circuit
-      for (auto &currentnc : *nc)
-        /* a = 0; a < nc->size(); a++ */
-        for (auto &currentnr : *nr)
-          /* b = 0; b < nr->size(); b++) */
-          if (currentnc->getCircuit() == currentnr->getCircuit()) {
-            circuit *ct = currentnc->getCircuit();
-            int pc = currentnc->getPort();
-            int pr = currentnr->getPort();
-            val += MatVal(ct->getN(pr, pc));
-          }
-      // put value into Cy matrix
-      C->set(r, c, val);
-    }
+/* Maps the noise current correlation matrix of each circuit to the
+ * rows of the MNA matrix, -1 for the ground node. */
+template <class nr_type_t> void nasolver<nr_type_t>::createNoiseMap() {
+  const int N = countNodes();
+  std::unordered_map<std::string, int> rows;
+  for (int r = 0; r < N; r++) {
+    rows[nlist->get(r)] = r;
   }
 
-  // go through each additional voltage source and put coefficients into
-  // the noise current correlation matrix
-  circuit *vsr, *vsc;
-  for (int r = 0; r < M; r++) {
-    vsr = findVoltageSource(r);
-    for (int c = 0; c < M; c++) {
-      vsc = findVoltageSource(c);
-      nr_type_t val = 0.0;
-      if (vsr == vsc) {
-        int ri = vsr->getSize() + r - vsr->getVoltageSource();
-        int ci = vsc->getSize() + c - vsc->getVoltageSource();
-        val = MatVal(vsr->getN(ri, ci));
-      }
-      C->set(r + N, c + N, val);
+  noiseMap.clear();
+  for (circuit *c = subnet->getRoot(); c != nullptr; c = c->getNext()) {
+    std::vector<int> r;
+    for (int i = 0; i < c->getSize(); i++) {
+      auto it = rows.find(c->getNode(i)->getName());
+      r.push_back(it == rows.end() ? -1 : it->second);
     }
+    for (int i = 0; i < c->getVoltageSources(); i++) {
+      r.push_back(N + c->getVoltageSource() + i);
+    }
+    noiseMap.emplace_back(c, std::move(r));
   }
+}
 
-  // go through each additional voltage source
-  for (int r = 0; r < M; r++) {
-    vsr = findVoltageSource(r);
-    // go through each node
-    for (int c = 0; c < N; c++) {
-      nr_type_t val = 0.0;
-      struct nodelist_t *n = nlist->getNode(c);
-      for (auto &currentn : *n)
-      /*i = 0; i < n->size(); i++ )*/
-      {
-        // is voltage source connected to node ?
-        if (currentn->getCircuit() == vsr) {
-          int ri = vsr->getSize() + r - vsr->getVoltageSource();
-          int ci = currentn->getPort();
-          val += MatVal(vsr->getN(ri, ci));
+/* Collects the non-zero entries of the noise current correlation
+ * matrix from the circuits.  As these are stored in the circuits the
+ * function must not run on several threads at once. */
+template <class nr_type_t>
+void nasolver<nr_type_t>::collectNoise(std::vector<noise_t> &sources) {
+  sources.clear();
+  for (auto &m : noiseMap) {
+    circuit *c = m.first;
+    const std::vector<int> &rows = m.second;
+    for (size_t i = 0; i < rows.size(); i++) {
+      if (rows[i] < 0)
+        continue;
+      for (size_t j = 0; j < rows.size(); j++) {
+        nr_complex_t v = c->getN(i, j);
+        if (rows[j] >= 0 && v != 0.0) {
+          sources.push_back({rows[i], rows[j], v});
         }
       }
-      // put value into Cy matrix
-      C->set(r + N, c, val);
     }
   }
+}
 
-  // go through each voltage source
-  for (int c = 0; c < M; c++) {
-    vsc = findVoltageSource(c);
-    // go through each node
-    for (int r = 0; r < N; r++) {
-      nr_type_t val = 0.0;
-      struct nodelist_t *n = nlist->getNode(r);
-      for (auto &currentn : *n) /*i = 0; i < n->size(); i++)*/
-      {
-        // is voltage source connected to node ?
-        if (currentn->getCircuit() == vsc) {
-          int ci = vsc->getSize() + c - vsc->getVoltageSource();
-          int ri = currentn->getPort();
-          val += MatVal(vsc->getN(ri, ci));
-        }
-      }
-      // put value into Cy matrix
-      C->set(r, c + N, val);
-    }
+/* Returns zp^T * Cy * zq* for the noise current correlations Cy given
+ * by their non-zero entries, e.g. the noise power due to the
+ * transimpedances zp = zq. */
+template <class nr_type_t>
+nr_complex_t nasolver<nr_type_t>::contractNoise(const std::vector<noise_t> &sources,
+                                                tvector<nr_complex_t> &zp,
+                                                tvector<nr_complex_t> &zq) {
+  nr_complex_t n = 0.0;
+  for (auto &s : sources) {
+    n += zp.get(s.r) * s.v * conj(zq.get(s.c));
   }
+  return n;
 }
 
 // Loads the right hand side vector.
@@ -595,7 +917,7 @@ template <class nr_type_t> void nasolver<nr_type_t>::createIVector() {
       // is this a current source?
       if (is->isISource() || is->isNonLinear()) {
         int port = currentn->getPort();
-        val += MatVal(is->getI(port)); // ARA: Read current from the device VectorI.
+        val += entryI(is, port); // ARA: Read current from the device VectorI.
       }
     }
     // put value into i vector
@@ -611,7 +933,7 @@ template <class nr_type_t> void nasolver<nr_type_t>::createEVector() {
   // go through each voltage source
   for (int r = 0; r < M; r++) {
     circuit *vs = findVoltageSource(r);
-    nr_type_t val = MatVal(vs->getE(r)); // ARA: Read voltage from the device VectorE.
+    nr_type_t val = entryE(vs, r); // ARA: Read voltage from the device VectorE.
     // put value into e vector
     z->set(r + N, val);
   }
@@ -721,8 +1043,25 @@ template <class nr_type_t> void nasolver<nr_type_t>::assignVoltageSources() {
 template <class nr_type_t> void nasolver<nr_type_t>::solveLinearEquations() {
   // just solve the equation system here
   eqns->setAlgo(eqnAlgo);
-  eqns->passEquationSys(updateMatrix ? A : nullptr, x, z);
+  eqns->setKrylovTol(krylovTol);
+  eqns->setKrylovMaxIter(krylovMaxIter);
+  if (isSparse()) {
+    eqns->passEquationSys(updateMatrix ? As : nullptr, x, z);
+  } else {
+    eqns->passEquationSys(updateMatrix ? A : nullptr, x, z);
+  }
   eqns->solve();
+  if (updateMatrix) {
+    factorizations++;
+    reuseCount = 0;
+  }
+  if (eqnAlgo == ALGO_GMRES || eqnAlgo == ALGO_BICGSTAB) {
+    logprint(LOG_STATUS, "NOTIFY: %s: %d Krylov iterations, residual %g\n", getName(),
+             eqns->getIterations(), eqns->getResidual());
+  } else if (eqnAlgo == ALGO_LU_DECOMPOSITION_MIXED) {
+    logprint(LOG_STATUS, "NOTIFY: %s: %d refinement steps, backward error %g\n", getName(),
+             eqns->getIterations(), eqns->getResidual());
+  }
 
   // if damped Newton-Raphson is requested
   if (xprev != nullptr && estack.top() == nullptr) {
@@ -736,6 +1075,268 @@ template <class nr_type_t> void nasolver<nr_type_t>::solveLinearEquations() {
   }
 }
 
+/* Decides whether the current Newton iteration reuses the LU factors
+ * of an earlier one (modified Newton).  This requires a factorization
+ * made during the current non-linear solution, at most `reuseMax'
+ * iterations ago, and the residual z - A * x to have at least halved
+ * since the previous iteration.  Otherwise the matrix is assembled and
+ * factorized again.  The residual is computed from the entries of the
+ * circuits since the A matrix may hold the LU factors. */
+template <class nr_type_t> bool nasolver<nr_type_t>::reuseFactors() {
+  if (reuseMax <= 0 || convHelper != CONV_None || xprev == nullptr)
+    return false;
+  switch (eqnAlgo) {
+  case ALGO_LU_DECOMPOSITION_CROUT:
+  case ALGO_LU_DECOMPOSITION_DOOLITTLE:
+  case ALGO_LU_DECOMPOSITION_BLOCKED:
+  case ALGO_LU_DECOMPOSITION_MIXED:
+  case ALGO_LU_DECOMPOSITION_SPARSE:
+  case ALGO_GMRES:
+  case ALGO_BICGSTAB:
+    break;
+  default:
+    return false;
+  }
+
+  // compute the residual z - A * x
+  if (stamps.empty()) {
+    createStampMap();
+  }
+  createZVector();
+  residual = *z;
+  forEachEntry([&](circuit *, int r, int c, nr_type_t v) { residual(r) -= v * x->get(c); });
+
+  const double r = maxnorm(residual);
+  const bool reuse =
+      reuseCount >= 0 && reuseCount < reuseMax && std::isfinite(r) && r <= 0.5 * residualPrev;
+  residualPrev = r;
+  if (reuse) {
+    reuseCount++;
+  }
+  return reuse;
+}
+
+/* Solves the modified Newton step A' * dx = z - A * x using the LU
+ * factors of the earlier matrix A' and updates the solution vector
+ * x += dx accordingly. */
+template <class nr_type_t> void nasolver<nr_type_t>::solveCorrection() {
+  tvector<nr_type_t> dx(x->size());
+  eqns->setAlgo(eqnAlgo);
+  eqns->passEquationSys((tmatrix<nr_type_t> *)nullptr, &dx, &residual);
+  eqns->solve();
+  *x = *x + dx;
+}
+
+/* Frees the data of the condensation of the linear subnetwork. */
+template <class nr_type_t> void nasolver<nr_type_t>::clearCondensation() {
+  delete Aii;
+  delete eqnsInner;
+  delete Wcond;
+  Aii = nullptr;
+  eqnsInner = nullptr;
+  Wcond = nullptr;
+  condMap.clear();
+  condRows.clear();
+  condInner.clear();
+  condLinear.clear();
+  condAib.clear();
+  condAbi.clear();
+}
+
+/* Frees the LU factors cached by solve_linear_cached(). */
+template <class nr_type_t> void nasolver<nr_type_t>::clearFactorCache() {
+  for (factors_t &e : factorCache) {
+    delete e.A;
+    delete e.As;
+    delete e.eqns;
+  }
+  factorCache.clear();
+}
+
+/* Splits the rows of the A matrix into the ones of the reduced system,
+ * i.e. the rows of the ports and voltage sources of the non-linear
+ * circuits, and the inner rows of the linear subnetwork.  The branch
+ * rows of linear voltage sources attached to the reduced system are
+ * kept there as well, otherwise the inner matrix becomes singular. */
+template <class nr_type_t> void nasolver<nr_type_t>::createCondensation() {
+  const int N = countNodes();
+  const int M = countVoltageSources();
+  std::vector<bool> reduced(N + M, false);
+
+  for (const stamp_t &s : stamps) {
+    circuit *c = s.c;
+    if (!c->isNonLinear())
+      continue;
+    for (int r : s.R) {
+      if (r >= 0)
+        reduced[r] = true;
+    }
+    for (int k = 0; k < c->getVoltageSources(); k++)
+      reduced[N + c->getVoltageSource() + k] = true;
+  }
+  for (const stamp_t &s : stamps) {
+    circuit *c = s.c;
+    bool attached = false;
+    for (int r : s.R) {
+      if (r >= 0 && reduced[r])
+        attached = true;
+    }
+    for (int k = 0; attached && k < c->getVoltageSources(); k++)
+      reduced[N + c->getVoltageSource() + k] = true;
+  }
+
+  condMap.assign(N + M, 0);
+  for (int r = 0; r < N + M; r++) {
+    if (reduced[r]) {
+      condMap[r] = (int)condRows.size();
+      condRows.push_back(r);
+    } else {
+      condMap[r] = -1 - (int)condInner.size();
+      condInner.push_back(r);
+    }
+  }
+  logprint(LOG_STATUS, "NOTIFY: %s: condensing %d linear rows, %d rows remaining\n", getName(),
+           (int)condInner.size(), (int)condRows.size());
+}
+
+/* Decides whether the current Newton iteration uses the condensed
+ * linear subnetwork and (re)computes the elimination of the inner rows
+ * if the entries of the linear circuits have changed since.  The
+ * condensation is turned off if the inner matrix turns out to be
+ * singular. */
+template <class nr_type_t> bool nasolver<nr_type_t>::condenseLinear() {
+  if (!condense || convHelper != CONV_None)
+    return false;
+  if (stamps.empty()) {
+    createStampMap();
+  }
+  if (condMap.empty()) {
+    createCondensation();
+  }
+  const int ni = (int)condInner.size();
+  const int nb = (int)condRows.size();
+  if (ni == 0)
+    return false;
+
+  // collect the entries outside the reduced system
+  std::vector<nr_type_t> linear;
+  linear.reserve(condLinear.size());
+  forEachEntry([&](circuit *, int r, int c, nr_type_t v) {
+    if (condMap[r] < 0 || condMap[c] < 0)
+      linear.push_back(v);
+  });
+  if (linear == condLinear)
+    return true;
+  condLinear.swap(linear);
+
+  // assemble the inner matrix and the coupling entries
+  if (Aii == nullptr) {
+    Aii = new tspmatrix<nr_type_t>(ni);
+    for (int i = 0; i < ni; i++)
+      Aii->insert(i, i);
+    forEachEntry([&](circuit *, int r, int c, nr_type_t) {
+      if (condMap[r] < 0 && condMap[c] < 0)
+        Aii->insert(-1 - condMap[r], -1 - condMap[c]);
+    });
+    Aii->compress();
+    eqnsInner = new eqnsys<nr_type_t>();
+    eqnsInner->setReuse(1);
+    Wcond = new tmatrix<nr_type_t>(nb);
+  }
+  Aii->set(0.0);
+  condAib.assign(nb, {});
+  condAbi.clear();
+  forEachEntry([&](circuit *, int r, int c, nr_type_t v) {
+    const int i = condMap[r], j = condMap[c];
+    if (i < 0 && j < 0)
+      Aii->add(-1 - i, -1 - j, v);
+    else if (i < 0)
+      condAib[j].push_back({-1 - i, v});
+    else if (j < 0)
+      condAbi.push_back({{i, -1 - j}, v});
+  });
+
+  // factorize the inner matrix
+  tvector<nr_type_t> y(ni), b(ni);
+  eqnsInner->setAlgo(ALGO_LU_FACTORIZATION_SPARSE);
+  eqnsInner->passEquationSys(Aii, &y, &b);
+  eqnsInner->solve();
+  if (estack.top()) {
+    estack.pop();
+    logprint(LOG_ERROR, "WARNING: %s: singular linear subnetwork, condensation disabled\n",
+             getName());
+    condense = 0;
+    return false;
+  }
+
+  // compute Abi * Aii^-1 * Aib column by column
+  eqnsInner->setAlgo(ALGO_LU_SUBSTITUTION_SPARSE);
+  Wcond->set(0.0);
+  for (int j = 0; j < nb; j++) {
+    if (condAib[j].empty())
+      continue;
+    b.set(0.0);
+    for (auto &e : condAib[j])
+      b(e.first) += e.second;
+    eqnsInner->passEquationSys((tspmatrix<nr_type_t> *)nullptr, &y, &b);
+    eqnsInner->solve();
+    for (auto &e : condAbi)
+      (*Wcond)(e.first.first, j) += e.second * y(e.first.second);
+  }
+  return true;
+}
+
+/* Solves the condensed system.  The right hand side of the inner rows
+ * is eliminated, the reduced system Ab * xb = zb - Abi * Aii^-1 * zi
+ * is solved and the inner solution xi = Aii^-1 * (zi - Aib * xb) is
+ * obtained by substitution. */
+template <class nr_type_t> void nasolver<nr_type_t>::solveCondensed() {
+  const int ni = (int)condInner.size();
+  const int nb = (int)condRows.size();
+  tmatrix<nr_type_t> Ab(nb);
+  tvector<nr_type_t> zb(nb), xb(nb), zi(ni), t(ni), y(ni);
+
+  // assemble the reduced matrix
+  forEachEntry([&](circuit *, int r, int c, nr_type_t v) {
+    if (condMap[r] >= 0 && condMap[c] >= 0)
+      Ab(condMap[r], condMap[c]) += v;
+  });
+  for (int r = 0; r < nb; r++) {
+    for (int c = 0; c < nb; c++)
+      Ab(r, c) -= (*Wcond)(r, c);
+  }
+
+  // eliminate the inner right hand side
+  createZVector();
+  for (int i = 0; i < ni; i++)
+    zi(i) = z->get(condInner[i]);
+  eqnsInner->passEquationSys((tspmatrix<nr_type_t> *)nullptr, &t, &zi);
+  eqnsInner->solve();
+  for (int r = 0; r < nb; r++)
+    zb(r) = z->get(condRows[r]);
+  for (auto &e : condAbi)
+    zb(e.first.first) -= e.second * t(e.first.second);
+
+  // solve the reduced system
+  eqnsys<nr_type_t> eqnsReduced;
+  eqnsReduced.setAlgo(ALGO_LU_DECOMPOSITION_CROUT);
+  eqnsReduced.passEquationSys(&Ab, &xb, &zb);
+  eqnsReduced.solve();
+
+  // back substitution of the inner rows
+  zi.set(0.0);
+  for (int j = 0; j < nb; j++) {
+    for (auto &e : condAib[j])
+      zi(e.first) += e.second * xb(j);
+  }
+  eqnsInner->passEquationSys((tspmatrix<nr_type_t> *)nullptr, &y, &zi);
+  eqnsInner->solve();
+  for (int r = 0; r < nb; r++)
+    x->set(condRows[r], xb(r));
+  for (int i = 0; i < ni; i++)
+    x->set(condInner[i], t(i) - y(i));
+}
+
 /* Applies a damped Newton-Raphson (limiting scheme) to the current solution vector
  * in the form x1 = x0 + a * (x1 - x0).
  * This convergence helper is heuristic and does not ensure global convergence. */
@@ -928,15 +1529,26 @@ template <class nr_type_t> void nasolver<nr_type_t>::restartDC() {
 template <class nr_type_t> void nasolver<nr_type_t>::applyNodeset(bool reset) {
   logprint(LOG_STATUS, "NOTIFY: %s: nasolver::applyNodeset()\n", getName());
 
+  // start from the prediction of a parameter sweep continuation once,
+  // retries of a failed solution start from scratch
+  bool predicted = false;
+  if (reset && contPending) {
+    contPending = false;
+    predicted = cont.predict(contParam, *x);
+    if (predicted) {
+      logprint(LOG_STATUS, "NOTIFY: %s: starting from the previous sweep points\n", getName());
+    }
+  }
+
   // set each solution to zero
-  if (reset) {
+  if (reset && !predicted) {
     for (int i = 0; i < x->size(); i++) {
       x->set(i, 0);
     }
   }
 
   // then apply the nodeset itself
-  for (nodeset *n = subnet->getNodeset(); n; n = n->getNext()) {
+  for (nodeset *n = subnet->getNodeset(); n && !predicted; n = n->getNext()) {
     struct nodelist_t *nl = nlist->getNode(n->getName());
     if (nl != nullptr) {
       x->set(nl->index, n->getValue());
@@ -957,6 +1569,24 @@ template <class nr_type_t> void nasolver<nr_type_t>::applyNodeset(bool reset) {
   restartDC();
 }
 
+/* Enables the continuation of a parameter sweep: the next solution
+   starts from the solutions of the previous sweep points extrapolated
+   to the given parameter value. */
+template <class nr_type_t> void nasolver<nr_type_t>::setContinuation(double p, bool first) {
+  if (first) {
+    cont.reset();
+  }
+  contParam = p;
+  contEnabled = contPending = true;
+}
+
+/* Keeps the converged solution for the following sweep points. */
+template <class nr_type_t> void nasolver<nr_type_t>::storeContinuation() {
+  if (contEnabled) {
+    cont.store(contParam, *x);
+  }
+}
+
 /* Saves the results of a single solve() functionality into the output dataset. */
 // ARA: Only called from the inherited analysis classes, such as `dcsolver`, etc.
 template <class nr_type_t>
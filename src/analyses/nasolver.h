@@ -23,10 +23,14 @@
 #define __NASOLVER_H__
 
 #include <string>
+#include <unordered_map>
+#include <vector>
 
 #include "analysis.h"
+#include "continuation.h"
 #include "eqnsys.h"
 #include "tmatrix.h"
+#include "tspmatrix.h"
 #include "tvector.h"
 
 #define CONV_None 0
@@ -36,6 +40,8 @@
 #define CONV_GMinStepping 4
 #define CONV_SourceStepping 5
 
+#define NA_FACTOR_CACHE 4 // LU factors kept by solve_linear_cached()
+
 namespace qucs {
 
 class analysis;
@@ -57,6 +63,7 @@ public:
   void solve_post();
   int solve_once();
   int solve_linear();
+  int solve_linear_cached(double);
   int solve_nonlinear();
   int solve_nonlinear_continuation_gMinStepping();
   int solve_nonlinear_continuation_SourceStepping();
@@ -72,6 +79,8 @@ public:
   }
   const char *getHelperDescription();
 
+  void setContinuation(double, bool) override;
+
   // Returns the number of node voltages in the circuit.
   int getN();
   // Returns the number of branch currents in the circuit.
@@ -88,21 +97,48 @@ protected:
   int countVoltageSources();
   circuit *findVoltageSource(int);
   void solveLinearEquations();
+  bool reuseFactors();
+  void solveCorrection();
+  bool condenseLinear();
+  void solveCondensed();
   bool checkConvergence();
   void saveSolution();
 
   void createMatrix();
-  void createNoiseMatrix();
+  void transposeMatrix();
+  bool isMatrixFinite();
+  bool isSparse() const { return As != nullptr; }
 
   void applyNodeset(bool reset = true);
+  void storeContinuation();
+  bool bypassCircuit(circuit *);
+  void setOrdering(const char *);
+  int factorizationAlgo(int);
+  int substitutionAlgo(int);
+
+  /* A non-zero entry of the noise current correlation matrix. */
+  struct noise_t {
+    int r, c;
+    nr_complex_t v;
+  };
+  void createNoiseMap();
+  void collectNoise(std::vector<noise_t> &);
+  static nr_complex_t contractNoise(const std::vector<noise_t> &, tvector<nr_complex_t> &,
+                                    tvector<nr_complex_t> &);
+
+  std::string createV(int, const std::string &, int);
+  std::string createI(int, const std::string &, int);
+  std::string createOP(const std::string &, const std::string &);
 
 private:
   void assignVoltageSources();
 
-  void createGMatrix();
-  void createBMatrix();
-  void createCMatrix();
-  void createDMatrix();
+  void createStampMap();
+  template <class F> void forEachEntry(F);
+  void createCondensation();
+  void clearCondensation();
+  void clearFactorCache();
+  void createAMatrix();
   void createIVector();
   void createEVector();
   void createZVector();
@@ -111,15 +147,17 @@ private:
   void lineSearch();
   void steepestDescent();
 
-  std::string createV(int, const std::string &, int);
-  std::string createI(int, const std::string &, int);
-  std::string createOP(const std::string &, const std::string &);
-
   void saveNodeVoltages();
   void saveBranchCurrents();
 
   nr_type_t MatValX(nr_complex_t, nr_complex_t *);
   nr_type_t MatValX(nr_complex_t, double *);
+  nr_type_t entryY(circuit *, int, int);
+  nr_type_t entryB(circuit *, int, int);
+  nr_type_t entryC(circuit *, int, int);
+  nr_type_t entryD(circuit *, int, int);
+  nr_type_t entryE(circuit *, int);
+  nr_type_t entryI(circuit *, int);
 
 protected:
   /* The right hand side input vector of the SLE. */
@@ -128,18 +166,82 @@ protected:
   tvector<nr_type_t> *x, *xprev;
   /* The left hand side input matrix of the SLE. */
   tmatrix<nr_type_t> *A;
-  tmatrix<nr_type_t> *C;
+  /* The left hand side matrix of the SLE if a sparse solver is used. */
+  tspmatrix<nr_type_t> *As;
 
   int iterations;
   int convHelper;
   int eqnAlgo;
   int updateMatrix;
+  int bypass;   // skip evaluations of circuits with unchanged voltages
+  int bypassed; // number of skipped evaluations
+  int ordering;   // fill-reducing ordering of the node rows
+  int condense;   // eliminate the linear subnetwork by a Schur complement
+  int reuseMax;   // maximum number of iterations reusing the LU factors
+  int reuseCount; // iterations since the last factorization, -1 if none
+  int factorizations;
+  double krylovTol; // tolerance and iteration limit of the Krylov solvers
+  int krylovMaxIter;
   double gMin, srcFactor;
   std::string desc;
+  /* The solutions of the previous points of a parameter sweep and the
+     parameter value of the current one. */
+  continuation<nr_type_t> cont;
+  double contParam;
+  bool contEnabled;
+  bool contPending; // the next applyNodeset() starts from the prediction
   nodelist *nlist; // ARA: This list exists for the duration of a single analysis.
 
 private:
   eqnsys<nr_type_t> *eqns;
+  /* The destination slots of the Y, B, C and D matrix entries of a
+     circuit inside the data of the A matrix, -1 for entries belonging
+     to the reference node. */
+  struct stamp_t {
+    circuit *c;
+    std::vector<int> Y, B, C, D;
+    std::vector<int> R; // rows of the ports
+  };
+  std::vector<stamp_t> stamps;
+  /* The node voltages of the last evaluation of each non-linear
+     circuit during the current Newton iteration and its matrix and
+     vector entries before that evaluation. */
+  struct bypass_t {
+    int evals = 0;
+    std::vector<double> V, Y, I;
+  };
+  std::unordered_map<circuit *, bypass_t> bypassState;
+  /* Condensation of the linear subnetwork.  The rows of the A matrix
+     touched by non-linear circuits form the reduced system, all other
+     (inner) rows are eliminated using the Schur complement
+     Ab = Abb - Abi * Aii^-1 * Aib.  The elimination depends on the
+     entries of the linear circuits only and is repeated when these
+     change, e.g. with the time step. */
+  std::vector<int> condMap;           // reduced (>= 0) or inner (-1 - i) index of each row
+  std::vector<int> condRows;          // rows of the reduced system
+  std::vector<int> condInner;         // rows of the inner system
+  std::vector<nr_type_t> condLinear;  // entries the elimination has been done for
+  std::vector<std::vector<std::pair<int, nr_type_t>>> condAib; // Aib by columns
+  std::vector<std::pair<std::pair<int, int>, nr_type_t>> condAbi;
+  tspmatrix<nr_type_t> *Aii;          // inner matrix and its LU factors
+  eqnsys<nr_type_t> *eqnsInner;
+  tmatrix<nr_type_t> *Wcond;          // Abi * Aii^-1 * Aib
+  /* The LU factors of the latest distinct matrices of a linear netlist,
+     the most recently used first, along with the key and the matrix
+     entries they have been computed for. */
+  struct factors_t {
+    double key;
+    std::vector<nr_type_t> entries;
+    tmatrix<nr_type_t> *A;
+    tspmatrix<nr_type_t> *As;
+    eqnsys<nr_type_t> *eqns;
+  };
+  std::vector<factors_t> factorCache;
+  /* The rows of the noise correlation matrix of each circuit. */
+  std::vector<std::pair<circuit *, std::vector<int>>> noiseMap;
+  /* The residual z - A * x of the current and the previous iterate. */
+  tvector<nr_type_t> residual;
+  double residualPrev;
   double reltol;
   double abstol;
   double vntol;
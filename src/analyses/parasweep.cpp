@@ -19,6 +19,17 @@
  * Boston, MA 02110-1301, USA.
  */
 
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <sys/wait.h>
+#include <unistd.h>
+
 #include "analysis.h"
 #include "complex.h"
 #include "dataset.h"
@@ -29,6 +40,7 @@
 #include "object.h"
 #include "parasweep.h"
 #include "ptrlist.h"
+#include "strlist.h"
 #include "sweep.h"
 #include "variable.h"
 #include "vector.h"
@@ -115,17 +127,28 @@ int parasweep::cleanup() {
 }
 
 int parasweep::solve() {
-  int err = 0;
   runs++;
 
+  const int points = swp->getSize();
+  const int workers = std::min(getPropertyInteger("Workers"), points);
+  if (workers > 1) {
+    return solve_parallel(workers);
+  }
+  return solve(0, points);
+}
+
+/* Runs the given range of sweep points. */
+int parasweep::solve(int first, int last) {
+  int err = 0;
+
   // get fixed simulation properties
   const char *const n = getPropertyString("Param");
+  const bool continuation = !strcmp(getPropertyString("Continuation"), "yes");
 
   // run the parameter sweep
-  swp->reset();
-  for (int i = 0; i < swp->getSize(); i++) {
+  for (int i = first; i < last; i++) {
     // obtain next sweep point
-    double v = swp->next();
+    double v = swp->get(i);
     // update environment and equation checker, then run solver
     env->setDoubleConstant(n, v);
     env->setDouble(n, v);
@@ -137,6 +160,9 @@ int parasweep::solve() {
     logprint(LOG_STATUS, "NOTIFY: %s: running netlist for %s = %g\n", getName(), n, v);
 #endif
     for (auto *a : *actions) {
+      // start from the solutions of the previous points
+      if (continuation)
+        a->setContinuation(v, i == first);
       err |= a->solve();
       // assign variable dataset dependencies to last order analyses
       ptrlist<analysis> *lastorder = subnet->findLastOrderChildren(this);
@@ -147,6 +173,174 @@ int parasweep::solve() {
   return err;
 }
 
+/* Marks the analyses below the sweep as having run.  These save the
+   values of their own sweeps (e.g. the frequencies) during their first
+   run only, which happens in the process of the first sweep points. */
+static void markRuns(ptrlist<analysis> *actions) {
+  if (actions == nullptr)
+    return;
+  for (auto *a : *actions) {
+    a->setRuns(std::max(a->getRuns(), 1));
+    markRuns(a->getAnalysis());
+  }
+}
+
+/* Writes the values the given dataset vectors got beyond the given
+   sizes, their dependencies and their origins into the given file.
+   The vectors are written oldest first. */
+static void writeVectors(FILE *f, qucs::vector *list,
+                         const std::unordered_map<std::string, int> &sizes) {
+  std::vector<qucs::vector *> vectors;
+  for (qucs::vector *v = list; v != nullptr; v = (qucs::vector *)v->getNext())
+    vectors.push_back(v);
+  auto putString = [f](const char *s) {
+    int len = s ? strlen(s) : -1;
+    fwrite(&len, sizeof(len), 1, f);
+    if (len > 0)
+      fwrite(s, 1, len, f);
+  };
+  int count = vectors.size();
+  fwrite(&count, sizeof(count), 1, f);
+  for (auto it = vectors.rbegin(); it != vectors.rend(); ++it) {
+    qucs::vector *v = *it;
+    auto size = sizes.find(v->getName());
+    int from = size == sizes.end() ? 0 : size->second;
+    putString(v->getName());
+    putString(v->getOrigin());
+    strlist *deps = v->getDependencies();
+    int n = deps ? deps->length() : -1;
+    fwrite(&n, sizeof(n), 1, f);
+    for (int i = 0; i < n; i++)
+      putString(deps->get(i));
+    n = v->getSize() - from;
+    fwrite(&n, sizeof(n), 1, f);
+    for (int i = from; i < v->getSize(); i++) {
+      nr_complex_t c = v->get(i);
+      fwrite(&c, sizeof(c), 1, f);
+    }
+  }
+}
+
+/* Reads the vectors written by writeVectors() and appends their values
+   to the vectors of the dataset, creating those not existing yet. */
+static bool readVectors(FILE *f, dataset *data, bool dependencies) {
+  auto getString = [f](std::string &s, bool &null) {
+    int len;
+    if (fread(&len, sizeof(len), 1, f) != 1)
+      return false;
+    null = len < 0;
+    s.resize(std::max(len, 0));
+    return len <= 0 || fread(&s[0], 1, len, f) == (size_t)len;
+  };
+  int count;
+  if (fread(&count, sizeof(count), 1, f) != 1)
+    return false;
+  for (int k = 0; k < count; k++) {
+    std::string name, origin, dep;
+    bool null, noOrigin;
+    int n;
+    if (!getString(name, null) || !getString(origin, noOrigin) ||
+        fread(&n, sizeof(n), 1, f) != 1)
+      return false;
+    strlist *deps = n < 0 ? nullptr : new strlist();
+    for (int i = 0; i < n; i++) {
+      if (!getString(dep, null)) {
+        delete deps;
+        return false;
+      }
+      deps->append(dep.c_str());
+    }
+    qucs::vector *v = dependencies ? data->findDependency(name.c_str())
+                                   : data->findVariable(name);
+    if (v == nullptr) {
+      v = new qucs::vector(name);
+      v->setOrigin(noOrigin ? nullptr : origin.c_str());
+      if (dependencies)
+        data->addDependency(v);
+      else
+        data->addVariable(v);
+    }
+    v->setDependencies(deps);
+    if (fread(&n, sizeof(n), 1, f) != 1)
+      return false;
+    for (int i = 0; i < n; i++) {
+      nr_complex_t c;
+      if (fread(&c, sizeof(c), 1, f) != 1)
+        return false;
+      v->add(c);
+    }
+  }
+  return true;
+}
+
+/* Runs the sweep on several worker processes.  Each of them is a copy
+   of this process, i.e. has its own netlist, environment and analyses,
+   and runs a contiguous range of the sweep points.  It writes the
+   values its analyses appended to the dataset into a temporary file,
+   which are then appended to the dataset in the order of the sweep
+   points, so the dataset is the same as the one of the serial sweep. */
+int parasweep::solve_parallel(int workers) {
+  const int points = swp->getSize();
+  std::unordered_map<std::string, int> dependencies, variables;
+  for (qucs::vector *v = data->getDependencies(); v; v = (qucs::vector *)v->getNext())
+    dependencies[v->getName()] = v->getSize();
+  for (qucs::vector *v = data->getVariables(); v; v = (qucs::vector *)v->getNext())
+    variables[v->getName()] = v->getSize();
+
+  logprint(LOG_STATUS, "NOTIFY: %s: running %d sweep points on %d processes\n", getName(),
+           points, workers);
+  std::vector<std::pair<pid_t, FILE *>> children;
+  fflush(nullptr);
+  for (int w = 0; w < workers; w++) {
+    FILE *f = tmpfile();
+    pid_t pid = f ? fork() : -1;
+    if (pid == 0) {
+      if (w > 0)
+        markRuns(actions);
+      int err = solve(points * w / workers, points * (w + 1) / workers);
+      writeVectors(f, data->getDependencies(), dependencies);
+      writeVectors(f, data->getVariables(), variables);
+      fflush(nullptr);
+      _exit(err ? 1 : 0);
+    }
+    if (pid < 0) {
+      logprint(LOG_ERROR, "ERROR: %s: cannot create worker process: %s\n", getName(),
+               strerror(errno));
+      if (f)
+        fclose(f);
+      break;
+    }
+    children.emplace_back(pid, f);
+  }
+
+  // collect the results of the workers in sweep order
+  int err = (int)children.size() < workers ? 1 : 0;
+  for (auto &child : children) {
+    int status;
+    FILE *f = child.second;
+    if (waitpid(child.first, &status, 0) < 0 || !WIFEXITED(status)) {
+      logprint(LOG_ERROR, "ERROR: %s: worker process failed\n", getName());
+      err = 1;
+    } else {
+      err |= WEXITSTATUS(status);
+      rewind(f);
+      if (!err && !(readVectors(f, data, true) && readVectors(f, data, false))) {
+        logprint(LOG_ERROR, "ERROR: %s: cannot read results of worker process\n", getName());
+        err = 1;
+      }
+    }
+    fclose(f);
+  }
+  markRuns(actions);
+
+  // leave the environment at the last sweep point as the serial sweep
+  const char *const n = getPropertyString("Param");
+  env->setDoubleConstant(n, swp->get(points - 1));
+  env->setDouble(n, swp->get(points - 1));
+  env->runSolver();
+  return err;
+}
+
 /* This function saves the results of a single solve() functionality
    into the output dataset. */
 void parasweep::saveResults() {
@@ -173,6 +367,8 @@ PROP_OPT[] = {
     {"Stop", PROP_REAL, {50, PROP_NO_STR}, PROP_NO_RANGE},
     {"Start", PROP_REAL, {5, PROP_NO_STR}, PROP_NO_RANGE},
     {"Values", PROP_LIST, {5, PROP_NO_STR}, PROP_NO_RANGE},
+    {"Workers", PROP_INT, {1, PROP_NO_STR}, PROP_RNGII(1, 256)},
+    {"Continuation", PROP_STR, {PROP_NO_VAL, "no"}, PROP_RNG_YESNO},
     PROP_NO_PROP,
 };
 struct define_t parasweep::anadef = {
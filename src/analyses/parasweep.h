@@ -42,6 +42,9 @@ public:
   void saveResults();
 
 private:
+  int solve(int, int);
+  int solve_parallel(int);
+
   variable *var;
   sweep *swp;
   void *eqn;
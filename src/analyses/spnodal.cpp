@@ -0,0 +1,185 @@
+/*
+ * spnodal.cpp - nodal S-parameter solver class implementation
+ *
+ * This is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this package; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street - Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include <algorithm>
+#include <cmath>
+
+#include "circuit.h"
+#include "complex.h"
+#include "nasolver.h"
+#include "net.h"
+#include "node.h"
+#include "spnodal.h"
+
+namespace qucs {
+
+spnodal::spnodal(net *subnet, const std::string &name, int noise, int solver)
+    : nasolver<nr_complex_t>(name) {
+  setNet(subnet);
+  setDescription("SP");
+  freq = 0;
+  this->noise = noise;
+  this->solver = solver;
+}
+
+spnodal::~spnodal() {}
+
+/* Initializes the circuits for the AC analysis, creates the node list
+   and the matrices and looks up the signal ports ordered by their
+   number. */
+void spnodal::init() {
+  circuit *root = subnet->getRoot();
+  ports.clear();
+  for (circuit *c = root; c != nullptr; c = c->getNext()) {
+    if (c->isNonLinear()) {
+      c->calcOperatingPoints();
+    }
+    c->setRealMNA(false);
+    c->initAC();
+    if (noise) {
+      c->initNoiseAC();
+    }
+    if (c->getPort()) {
+      ports.push_back({c, -1, -1, 1.0 / c->getPropertyDouble("Z")});
+    }
+  }
+  std::sort(ports.begin(), ports.end(),
+            [](const port_t &a, const port_t &b) { return a.c->getPort() < b.c->getPort(); });
+
+  setCalculation((calculate_func_t)&calcSP);
+  eqnAlgo = solver;
+  solve_pre();
+  if (noise) {
+    createNoiseMap();
+  }
+  for (auto &p : ports) {
+    p.p = getNodeIndex(p.c->getNode(NODE_1)->getName()) - 1;
+    p.n = getNodeIndex(p.c->getNode(NODE_2)->getName()) - 1;
+  }
+}
+
+void spnodal::finish() { solve_post(); }
+
+/* Evaluates the circuits at the given frequency and copies the MNA
+   matrix and the non-zero noise current correlations.  As these are
+   taken from the matrices of the circuits the function must not run
+   on several threads at once. */
+void spnodal::assemble(double f, system_t &s) {
+  freq = f;
+  calculate();
+  updateMatrix = 1;
+  createMatrix();
+  if (isSparse())
+    s.As = *As;
+  else
+    s.A = *A;
+  if (noise) {
+    collectNoise(s.C);
+  }
+}
+
+/* Computes the S-parameters and, if requested, the noise wave
+   correlation matrix of the ports from the given MNA matrices using
+   the given equation system.  The matrices are overwritten. */
+void spnodal::solve(system_t &s, eqnsys<nr_complex_t> &eqns, tmatrix<nr_complex_t> &S,
+                    tmatrix<nr_complex_t> &N) {
+  const int n = countNodes() + countVoltageSources();
+  const int P = ports.size();
+  tvector<nr_complex_t> x(n), b(n);
+  tmatrix<nr_complex_t> At;
+  if (noise && !isSparse())
+    At = s.A; // the dense factors overwrite the matrix
+
+  // a unit current into port k yields column k of the impedance matrix
+  S = tmatrix<nr_complex_t>(P);
+  eqns.setAlgo(factorizationAlgo(solver));
+  if (isSparse())
+    eqns.passEquationSys(&s.As, &x, &b);
+  else
+    eqns.passEquationSys(&s.A, &x, &b);
+  eqns.solve();
+  eqns.setAlgo(substitutionAlgo(solver));
+  for (int k = 0; k < P; k++) {
+    b.set(0);
+    if (ports[k].p >= 0)
+      b.set(ports[k].p, +1);
+    if (ports[k].n >= 0)
+      b.set(ports[k].n, -1);
+    eqns.passEquationSys((tmatrix<nr_complex_t> *)nullptr, &x, &b);
+    eqns.solve();
+    for (int j = 0; j < P; j++) {
+      nr_complex_t v = 0.0;
+      if (ports[j].p >= 0)
+        v += x.get(ports[j].p);
+      if (ports[j].n >= 0)
+        v -= x.get(ports[j].n);
+      S.set(j, k, 2.0 * std::sqrt(ports[j].g * ports[k].g) * v - (j == k ? 1.0 : 0.0));
+    }
+  }
+  if (!noise)
+    return;
+
+  /* The voltage of port p due to the noise currents i is w_p^T * i
+     where A^T * w_p selects the port.  With the ports terminated by
+     their noiseless reference impedances the outgoing noise waves are
+     sqrt(G) * v. */
+  std::vector<tvector<nr_complex_t>> w(P);
+  eqns.setAlgo(factorizationAlgo(solver));
+  if (isSparse()) {
+    s.As.transpose();
+    eqns.passEquationSys(&s.As, &x, &b);
+  } else {
+    At.transpose();
+    eqns.passEquationSys(&At, &x, &b);
+  }
+  eqns.solve();
+  eqns.setAlgo(substitutionAlgo(solver));
+  for (int p = 0; p < P; p++) {
+    b.set(0);
+    if (ports[p].p >= 0)
+      b.set(ports[p].p, +1);
+    if (ports[p].n >= 0)
+      b.set(ports[p].n, -1);
+    eqns.passEquationSys((tmatrix<nr_complex_t> *)nullptr, &x, &b);
+    eqns.solve();
+    w[p] = x;
+  }
+  N = tmatrix<nr_complex_t>(P);
+  for (int p = 0; p < P; p++) {
+    for (int q = 0; q < P; q++) {
+      N.set(p, q, std::sqrt(ports[p].g * ports[q].g) * contractNoise(s.C, w[p], w[q]));
+    }
+  }
+}
+
+/* Goes through the list of circuit objects and runs its calcAC()
+   function.  The noise of the signal ports is left out since their
+   reference impedances are noiseless by the definition of the noise
+   waves. */
+void spnodal::calcSP(spnodal *self) {
+  circuit *root = self->getNet()->getRoot();
+  for (circuit *c = root; c != nullptr; c = c->getNext()) {
+    c->calcAC(self->freq);
+    if (self->noise && !c->getPort()) {
+      c->calcNoiseAC(self->freq);
+    }
+  }
+}
+
+} // namespace qucs
@@ -0,0 +1,84 @@
+/*
+ * spnodal.h - nodal S-parameter solver class definitions
+ *
+ * This is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this package; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street - Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef __SPNODAL_H__
+#define __SPNODAL_H__
+
+#include <vector>
+
+#include "nasolver.h"
+
+namespace qucs {
+
+class circuit;
+class net;
+
+/* The nodal engine of the S-parameter analysis.  At each frequency it
+   assembles the complex MNA matrix of the network including the
+   reference impedances of the signal ports, factorizes it once and
+   solves it for a unit current injected into each port.  The resulting
+   port voltages form the impedance matrix Zt of the terminated network
+   from which S = 2 * sqrt(G) * Zt * sqrt(G) - E follows, G being the
+   reference admittances of the ports.  This is the ytos() conversion
+   without inverting the port admittance matrix, which does not exist
+   for ports shorted or open at some frequency.  The noise wave
+   correlation matrix of the ports is obtained by the adjoint method. */
+class spnodal final : public nasolver<nr_complex_t> {
+public:
+  spnodal(net *, const std::string &, int, int);
+  spnodal(const spnodal &) = delete;
+  ~spnodal() override;
+
+  /* The MNA matrix and the noise current correlations of a single
+     frequency. */
+  struct system_t {
+    tmatrix<nr_complex_t> A;
+    tspmatrix<nr_complex_t> As;
+    std::vector<noise_t> C;
+  };
+
+  void init();
+  void assemble(double, system_t &);
+  void solve(system_t &, eqnsys<nr_complex_t> &, tmatrix<nr_complex_t> &,
+             tmatrix<nr_complex_t> &);
+  void finish();
+
+  int countPorts() const { return ports.size(); }
+  circuit *getPort(int p) const { return ports[p].c; }
+
+private:
+  static void calcSP(spnodal *);
+
+private:
+  /* A signal port, its rows in the MNA matrix (-1 for the ground node)
+     and its reference admittance. */
+  struct port_t {
+    circuit *c;
+    int p, n;
+    double g;
+  };
+  std::vector<port_t> ports;
+  double freq;
+  int noise;
+  int solver;
+};
+
+} // namespace qucs
+
+#endif /* __SPNODAL_H__ */
@@ -19,7 +19,15 @@
  * Boston, MA 02110-1301, USA.
  */
 
+#include <algorithm>
 #include <cstring>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <tuple>
+#include <unordered_map>
 
 #include "precision.h"
 #include "logging.h"
@@ -33,9 +41,11 @@
 #include "net.h"
 #include "analysis.h"
 #include "sweep.h"
-#include "nodelist.h"
 #include "netdefs.h"
 #include "spsolver.h"
+#include "spnodal.h"
+#include "adaptsweep.h"
+#include "exceptionstack.h"
 #include "components/component_id.h"
 #include "components/helpers/tee.h"
 #include "components/helpers/open.h"
@@ -46,7 +56,6 @@
 /* Evolved optimization flags. */
 #define USE_GROUNDS 1   // use extra grounds ?
 #define USE_CROSSES 1   // use additional cross connectors ?
-#define SORTED_LIST 1   // use sorted node list?
 
 #define TINYS (NR_TINY * 1.235) // 'tiny' value for singularities
 
@@ -57,7 +66,8 @@ spsolver::spsolver () : analysis () {
   swp = NULL;
   saveCVs = 0;
   noise = 0;
-  nlist = NULL;
+  threads = 1;
+  slots = 0;
   tees = crosses = opens = grounds = 0;
   gnd = NULL;
 }
@@ -67,39 +77,32 @@ spsolver::spsolver (char * n) : analysis (n) {
   swp = NULL;
   saveCVs = 0;
   noise = 0;
-  nlist = NULL;
+  threads = 1;
+  slots = 0;
   tees = crosses = opens = grounds = 0;
   gnd = NULL;
 }
 
 spsolver::~spsolver () {
   delete swp;
-  delete nlist;
 }
 
-/* This function joins two nodes of a single circuit (interconnected
-   nodes) and returns the resulting circuit. */
-circuit * spsolver::interconnectJoin (node * n1, node * n2) {
-  circuit * s = n1->getCircuit ();
-  circuit * result = new circuit (s->getSize () - 2);
+/* This function joins the ports k and l of a single circuit
+   (interconnected nodes) and stores the resulting S-parameters. */
+void spsolver::interconnectJoin (spmatrix_t & r, const spmatrix_t & s,
+				 int k, int l) {
   nr_complex_t p;
 
-  // allocate S-parameter and noise correlation matrices
-  result->initSP (); if (noise) result->initNoiseSP ();
-
-  // interconnected port numbers
-  int k = n1->getPort (), l = n2->getPort ();
-
   // denominator needs to be calculated only once
-  nr_complex_t d = (1.0 - s->getS (k, l)) * (1.0 - s->getS (l, k)) -
-    s->getS (k, k) * s->getS (l, l);
+  nr_complex_t d = (1.0 - s.getS (k, l)) * (1.0 - s.getS (l, k)) -
+    s.getS (k, k) * s.getS (l, l);
 
   // avoid singularity when two full reflective ports are interconnected
   double tiny1 = (d == 0) ? 1.0 - TINYS : 1.0;
   double tiny2 = tiny1 * tiny1;
   double tiny3 = tiny1 * tiny2;
-  d = (1.0 - s->getS (k, l) * tiny1) * (1.0 - s->getS (l, k) * tiny1) -
-    s->getS (k, k) * s->getS (l, l) * tiny2;
+  d = (1.0 - s.getS (k, l) * tiny1) * (1.0 - s.getS (l, k) * tiny1) -
+    s.getS (k, k) * s.getS (l, l) * tiny2;
 
   int j2; // column index for resulting matrix
   int i2; // row index for resulting matrix
@@ -108,59 +111,47 @@ circuit * spsolver::interconnectJoin (node * n1, node * n2) {
 
   // handle single S block only
   i2 = j2 = 0;
-  for (j1 = 0; j1 < s->getSize (); j1++) {
+  for (j1 = 0; j1 < s.getSize (); j1++) {
 
     // skip connected node
     if (j1 == k || j1 == l) continue;
 
-    // assign node name of resulting circuit
-    result->setNode (j2, s->getNode(j1)->getName ());
-
     // inside S only
-    for (i1 = 0; i1 < s->getSize (); i1++) {
+    for (i1 = 0; i1 < s.getSize (); i1++) {
 
       // skip connected node
       if (i1 == k || i1 == l) continue;
 
       // compute S'ij
-      p = s->getS (i1, j1);
+      p = s.getS (i1, j1);
       p +=
-	(s->getS (k, j1) * s->getS (i1, l) * (1.0 - s->getS (l, k)) * tiny3 +
-	 s->getS (l, j1) * s->getS (i1, k) * (1.0 - s->getS (k, l)) * tiny3 +
-	 s->getS (k, j1) * s->getS (l, l) * s->getS (i1, k) * tiny3 +
-	 s->getS (l, j1) * s->getS (k, k) * s->getS (i1, l) * tiny3) / d;
-      result->setS (i2++, j2, p);
+	(s.getS (k, j1) * s.getS (i1, l) * (1.0 - s.getS (l, k)) * tiny3 +
+	 s.getS (l, j1) * s.getS (i1, k) * (1.0 - s.getS (k, l)) * tiny3 +
+	 s.getS (k, j1) * s.getS (l, l) * s.getS (i1, k) * tiny3 +
+	 s.getS (l, j1) * s.getS (k, k) * s.getS (i1, l) * tiny3) / d;
+      r.setS (i2++, j2, p);
     }
 
     // next column
     j2++; i2 = 0;
   }
-  return result;
 }
 
-/* This function joins two nodes of two different circuits (connected
-   nodes) and returns the resulting circuit. */
-circuit * spsolver::connectedJoin (node * n1, node * n2) {
-
-  circuit * s = n1->getCircuit ();
-  circuit * t = n2->getCircuit ();
-  circuit * result = new circuit (s->getSize () + t->getSize () - 2);
+/* This function joins the port k of one circuit with the port l of
+   another circuit (connected nodes) and stores the resulting
+   S-parameters. */
+void spsolver::connectedJoin (spmatrix_t & r, const spmatrix_t & s,
+			      const spmatrix_t & t, int k, int l) {
   nr_complex_t p;
 
-  // allocate S-parameter and noise correlation matrices
-  result->initSP (); if (noise) result->initNoiseSP ();
-
-  // connected port numbers
-  int k = n1->getPort (), l = n2->getPort ();
-
   // denominator needs to be calculated only once
-  nr_complex_t d = 1.0 - s->getS (k, k) * t->getS (l, l);
+  nr_complex_t d = 1.0 - s.getS (k, k) * t.getS (l, l);
 
   // avoid singularity when two full reflective ports are connected
   double tiny1 = (d == 0) ? 1.0 - TINYS : 1.0;
   double tiny2 = tiny1 * tiny1;
   double tiny3 = tiny1 * tiny2;
-  d = 1.0 - s->getS (k, k) * t->getS (l, l) * tiny2;
+  d = 1.0 - s.getS (k, k) * t.getS (l, l) * tiny2;
 
   int j2; // column index for resulting matrix
   int i2; // row index for resulting matrix
@@ -169,99 +160,87 @@ circuit * spsolver::connectedJoin (node * n1, node * n2) {
 
   // handle S block
   i2 = j2 = 0;
-  for (j1 = 0; j1 < s->getSize (); j1++) {
+  for (j1 = 0; j1 < s.getSize (); j1++) {
 
     // skip connected node
     if (j1 == k) continue;
 
-    // assign node name of resulting circuit
-    result->setNode (j2, s->getNode(j1)->getName());
-
     // inside S
-    for (i1 = 0; i1 < s->getSize (); i1++) {
+    for (i1 = 0; i1 < s.getSize (); i1++) {
 
       // skip connected node
       if (i1 == k) continue;
 
       // compute S'ij
-      p  = s->getS (i1, j1);
-      p += s->getS (k, j1) * t->getS (l, l) * s->getS (i1, k) * tiny3 / d;
-      result->setS (i2++, j2, p);
+      p  = s.getS (i1, j1);
+      p += s.getS (k, j1) * t.getS (l, l) * s.getS (i1, k) * tiny3 / d;
+      r.setS (i2++, j2, p);
     }
 
     // across S and T
-    for (i1 = 0; i1 < t->getSize (); i1++) {
+    for (i1 = 0; i1 < t.getSize (); i1++) {
 
       // skip connected node
       if (i1 == l) continue;
 
       // compute S'mj
-      p = s->getS (k, j1) * t->getS (i1, l) * tiny2 / d;
-      result->setS (i2++, j2, p);
+      p = s.getS (k, j1) * t.getS (i1, l) * tiny2 / d;
+      r.setS (i2++, j2, p);
     }
     // next column
     j2++; i2 = 0;
   }
 
   // handle T block
-  for (j1 = 0; j1 < t->getSize (); j1++) {
+  for (j1 = 0; j1 < t.getSize (); j1++) {
 
     // skip connected node
     if (j1 == l) continue;
 
-    // assign node name of resulting circuit
-    result->setNode (j2, t->getNode(j1)->getName ());
-
     // across T and S
-    for (i1 = 0; i1 < s->getSize (); i1++) {
+    for (i1 = 0; i1 < s.getSize (); i1++) {
 
       // skip connected node
       if (i1 == k) continue;
 
       // compute S'mj
-      p = t->getS (l, j1) * s->getS (i1, k) * tiny2 / d;
-      result->setS (i2++, j2, p);
+      p = t.getS (l, j1) * s.getS (i1, k) * tiny2 / d;
+      r.setS (i2++, j2, p);
     }
 
     // inside T
-    for (i1 = 0; i1 < t->getSize (); i1++) {
+    for (i1 = 0; i1 < t.getSize (); i1++) {
 
       // skip connected node
       if (i1 == l) continue;
 
       // compute S'ij
-      p  = t->getS (i1, j1);
-      p += t->getS (l, j1) * s->getS (k, k) * t->getS (i1, l) * tiny3 / d;
-      result->setS (i2++, j2, p);
+      p  = t.getS (i1, j1);
+      p += t.getS (l, j1) * s.getS (k, k) * t.getS (i1, l) * tiny3 / d;
+      r.setS (i2++, j2, p);
     }
 
     // next column
     j2++; i2 = 0;
   }
-
-  return result;
 }
 
-/* This function joins the two given nodes of a single circuit
-   (interconnected nodes) and modifies the resulting circuit
-   appropriately. */
-void spsolver::noiseInterconnect (circuit * result, node * n1, node * n2) {
-
-  circuit * c = n1->getCircuit ();
+/* This function joins the ports k and l of a single circuit
+   (interconnected nodes) and stores the resulting noise wave
+   correlation matrix. */
+void spsolver::noiseInterconnect (spmatrix_t & r, const spmatrix_t & c,
+				  int k, int l) {
   nr_complex_t p, k1, k2, k3, k4;
 
-  // interconnected port numbers
-  int k = n1->getPort (), l = n2->getPort ();
-
   // denominator needs to be calculated only once
-  nr_complex_t t = (1.0 - c->getS (k, l)) * (1.0 - c->getS (l, k)) -
-    c->getS (k, k) * c->getS (l, l);
+  nr_complex_t t = (1.0 - c.getS (k, l)) * (1.0 - c.getS (l, k)) -
+    c.getS (k, k) * c.getS (l, l);
 
   // avoid singularity when two full reflective ports are interconnected
   double tiny1 = (t == 0) ? 1.0 - TINYS : 1.0;
   double tiny2 = tiny1 * tiny1;
-  t = (1.0 - c->getS (k, l) * tiny1) * (1.0 - c->getS (l, k) * tiny1) -
-    c->getS (k, k) * c->getS (l, l) * tiny2;
+  t = (1.0 - c.getS (k, l) * tiny1) * (1.0 - c.getS (l, k) * tiny1) -
+    c.getS (k, k) * c.getS (l, l) * tiny2;
 
   int j2; // column index for resulting matrix
   int i2; // row index for resulting matrix
@@ -270,36 +249,36 @@ void spsolver::noiseInterconnect (circuit * result, node * n1, node * n2) {
 
   // handle single C block only
   i2 = j2 = 0;
-  for (j1 = 0; j1 < c->getSize (); j1++) {
+  for (j1 = 0; j1 < c.getSize (); j1++) {
 
     // skip connected node
     if (j1 == k || j1 == l) continue;
 
     // inside C only
-    for (i1 = 0; i1 < c->getSize (); i1++) {
+    for (i1 = 0; i1 < c.getSize (); i1++) {
 
       // skip connected node
       if (i1 == k || i1 == l) continue;
 
-      k1 = (c->getS (i1, l) * (1.0 - c->getS (l, k)) +
-	    c->getS (l, l) * c->getS (i1, k)) * tiny2 / t;
-      k2 = (c->getS (i1, k) * (1.0 - c->getS (k, l)) +
-	    c->getS (k, k) * c->getS (i1, l)) * tiny2 / t;
-      k3 = (c->getS (j1, l) * (1.0 - c->getS (l, k)) +
-	    c->getS (l, l) * c->getS (j1, k)) * tiny2 / t;
-      k4 = (c->getS (j1, k) * (1.0 - c->getS (k, l)) +
-	    c->getS (k, k) * c->getS (j1, l)) * tiny2 / t;
+      k1 = (c.getS (i1, l) * (1.0 - c.getS (l, k)) +
+	    c.getS (l, l) * c.getS (i1, k)) * tiny2 / t;
+      k2 = (c.getS (i1, k) * (1.0 - c.getS (k, l)) +
+	    c.getS (k, k) * c.getS (i1, l)) * tiny2 / t;
+      k3 = (c.getS (j1, l) * (1.0 - c.getS (l, k)) +
+	    c.getS (l, l) * c.getS (j1, k)) * tiny2 / t;
+      k4 = (c.getS (j1, k) * (1.0 - c.getS (k, l)) +
+	    c.getS (k, k) * c.getS (j1, l)) * tiny2 / t;
 
       p =
-	c->getN (i1, j1) + c->getN (k, j1) * k1 + c->getN (l, j1) * k2 +
-	conj (k3) * (c->getN (i1, k) + c->getN (k, k) * k1 +
-		     c->getN (l, k) * k2) +
-	conj (k4) * (c->getN (i1, l) + c->getN (k, l) * k1 +
-		     c->getN (l, l) * k2);
-      result->setN (i2, j2, p);
+	c.getN (i1, j1) + c.getN (k, j1) * k1 + c.getN (l, j1) * k2 +
+	conj (k3) * (c.getN (i1, k) + c.getN (k, k) * k1 +
+		     c.getN (l, k) * k2) +
+	conj (k4) * (c.getN (i1, l) + c.getN (k, l) * k1 +
+		     c.getN (l, l) * k2);
+      r.setN (i2, j2, p);
 
       if (i2 >= j2) break; // the other half need not be computed
-      result->setN (j2, i2, conj (p));
+      r.setN (j2, i2, conj (p));
       i2++;
     }
 
@@ -309,26 +288,22 @@ void spsolver::noiseInterconnect (circuit * result, node * n1, node * n2) {
 }
 
 
-/* The following function joins two nodes of two different circuits
-   and saves the noise wave correlation matrix in the resulting
-   circuit. */
-void spsolver::noiseConnect (circuit * result, node * n1, node * n2) {
-  circuit * c = n1->getCircuit ();
-  circuit * d = n2->getCircuit ();
+/* The following function joins the port k of one circuit with the
+   port l of another circuit and stores the resulting noise wave
+   correlation matrix. */
+void spsolver::noiseConnect (spmatrix_t & r, const spmatrix_t & c,
+			     const spmatrix_t & d, int k, int l) {
   nr_complex_t p;
 
-  // connected port numbers
-  int k = n1->getPort (), l = n2->getPort ();
-
   // denominator needs to be calculated only once
-  nr_complex_t t = 1.0 - c->getS (k, k) * d->getS (l, l);
+  nr_complex_t t = 1.0 - c.getS (k, k) * d.getS (l, l);
 
   // avoid singularity when two full reflective ports are connected
   double tiny1 = (t == 0) ? 1.0 - TINYS : 1.0;
   double tiny2 = tiny1 * tiny1;
   double tiny3 = tiny1 * tiny2;
   double tiny4 = tiny1 * tiny3;
-  t = 1.0 - c->getS (k, k) * d->getS (l, l) * tiny2;
+  t = 1.0 - c.getS (k, k) * d.getS (l, l) * tiny2;
 
   int j2; // column index for resulting matrix
   int i2; // row index for resulting matrix
@@ -337,27 +312,27 @@ void spsolver::noiseConnect (circuit * result, node * n1, node * n2) {
 
   // handle C block
   i2 = j2 = 0;
-  for (j1 = 0; j1 < c->getSize (); j1++) {
+  for (j1 = 0; j1 < c.getSize (); j1++) {
 
     // skip connected node
     if (j1 == k) continue;
 
     // inside C
-    for (i1 = 0; i1 < c->getSize (); i1++) {
+    for (i1 = 0; i1 < c.getSize (); i1++) {
 
       // skip connected node
       if (i1 == k) continue;
 
       // compute C'ij
-      p = c->getN (i1, j1) +
-	c->getN (k, j1) * d->getS (l, l) * c->getS (i1, k) * tiny2 / t +
-	c->getN (i1, k) * conj (d->getS (l, l) * c->getS (j1, k) * tiny2 / t) +
-	(c->getN (k, k) * norm (d->getS (l, l)) + d->getN (l, l)) *
-	c->getS (i1, k) * conj (c->getS (j1, k)) * tiny4 / norm (t);
+      p = c.getN (i1, j1) +
+	c.getN (k, j1) * d.getS (l, l) * c.getS (i1, k) * tiny2 / t +
+	c.getN (i1, k) * conj (d.getS (l, l) * c.getS (j1, k) * tiny2 / t) +
+	(c.getN (k, k) * norm (d.getS (l, l)) + d.getN (l, l)) *
+	c.getS (i1, k) * conj (c.getS (j1, k)) * tiny4 / norm (t);
 
-      result->setN (i2, j2, p);
+      r.setN (i2, j2, p);
       if (i2 >= j2) break; // the other half need not be computed
-      result->setN (j2, i2, conj (p));
+      r.setN (j2, i2, conj (p));
       i2++;
     }
 
@@ -370,43 +345,43 @@ void spsolver::noiseConnect (circuit * result, node * n1, node * n2) {
   }
 
   // handle D block
-  for (j1 = 0; j1 < d->getSize (); j1++) {
+  for (j1 = 0; j1 < d.getSize (); j1++) {
 
     // skip connected node
     if (j1 == l) continue;
 
     // across D and C
-    for (i1 = 0; i1 < c->getSize (); i1++) {
+    for (i1 = 0; i1 < c.getSize (); i1++) {
 
       // skip connected node
       if (i1 == k) continue;
 
       // compute C'ij
-      p = (c->getN (k, k) * d->getS (l, l) +
-	   d->getN (l, l) * conj (c->getS (k, k))) *
-	c->getS (i1, k) * conj (d->getS (j1, l)) * tiny3 / norm (t) +
-	d->getN (l, j1) * c->getS (i1, k) * tiny1 / t +
-	c->getN (i1, k) * conj (d->getS (j1, l) * tiny1 / t);
-      result->setN (i2, j2, p);
-      result->setN (j2, i2, conj (p));
+      p = (c.getN (k, k) * d.getS (l, l) +
+	   d.getN (l, l) * conj (c.getS (k, k))) *
+	c.getS (i1, k) * conj (d.getS (j1, l)) * tiny3 / norm (t) +
+	d.getN (l, j1) * c.getS (i1, k) * tiny1 / t +
+	c.getN (i1, k) * conj (d.getS (j1, l) * tiny1 / t);
+      r.setN (i2, j2, p);
+      r.setN (j2, i2, conj (p));
       i2++;
     }
 
     // inside D
-    for (i1 = 0; i1 < d->getSize (); i1++) {
+    for (i1 = 0; i1 < d.getSize (); i1++) {
 
       // skip connected node
       if (i1 == l) continue;
 
       // compute C'ij
-      p = d->getN (i1, j1) +
-	(d->getN (l, l) * norm (c->getS (k, k)) + c->getN (k, k)) *
-	d->getS (i1, l) * conj (d->getS (j1, l)) * tiny4 / norm (t) +
-	d->getN (i1, l) * conj (c->getS (k, k) * d->getS (j1, l) * tiny2 / t) +
-	d->getN (l, j1) * c->getS (k, k) * d->getS (i1, l) * tiny2 / t;
-      result->setN (i2, j2, p);
+      p = d.getN (i1, j1) +
+	(d.getN (l, l) * norm (c.getS (k, k)) + c.getN (k, k)) *
+	d.getS (i1, l) * conj (d.getS (j1, l)) * tiny4 / norm (t) +
+	d.getN (i1, l) * conj (c.getS (k, k) * d.getS (j1, l) * tiny2 / t) +
+	d.getN (l, j1) * c.getS (k, k) * d.getS (i1, l) * tiny2 / t;
+      r.setN (i2, j2, p);
       if (i2 >= j2) break; // the other half need not be computed
-      result->setN (j2, i2, conj (p));
+      r.setN (j2, i2, conj (p));
       i2++;
     }
 
@@ -425,99 +400,215 @@ void spsolver::calc (double freq) {
   }
 }
 
-/* Go through each registered circuit object in the list and find the
-   connection which results in a new subnetwork with the smallest
-   number of s-parameters to calculate. */
-void spsolver::reduce (void) {
-
-#if SORTED_LIST
-  node * n1, * n2;
-  circuit * result, * cand1, * cand2;
-
-  nlist->sortedNodes (&n1, &n2);
-  cand1 = n1->getCircuit ();
-  cand2 = n2->getCircuit ();
-#else /* !SORTED_LIST */
-  node * n1, * n2, * cand;
-  circuit * result, * c1, * c2, * cand1, * cand2;
-  int ports;
+/* The order in which the network is reduced depends on its topology
+   only.  Thus the joins are planned once before the frequency sweep
+   using the node names of the circuits and recorded in a schedule
+   which is replayed for each frequency.  Joining two circuits is
+   proportional to the square of the resulting number of ports.  The
+   connections are chosen greedily by the number of ports the result
+   has once all the further nodes shared by the two circuits are
+   interconnected as well, which are then joined right away since an
+   interconnect always shrinks a circuit.  Each matrix of the
+   reduction is assigned to a buffer which is reused once the matrix
+   has been consumed by a join. */
+void spsolver::createSchedule (void) {
+  std::unordered_map<std::string, int> names;
+  std::vector<circuit *> signal;        // port circuit of each node
+  std::vector<std::vector<int>> owners; // circuits connected to each node
+  std::vector<std::vector<int>> ports;  // nodes of each circuit
+  std::vector<int> slot, free;
   circuit * root = subnet->getRoot ();
 
-  // initialize local variables
-  result = c1 = c2 = cand1 = cand2 = NULL;
-  n1 = n2 = cand = NULL;
-  ports = 10000; // huge
+  auto id = [&] (node * n) {
+    auto it = names.emplace (n->getName (), (int) names.size ()).first;
+    if (it->second == (int) signal.size ()) {
+      signal.push_back (NULL);
+      owners.emplace_back ();
+    }
+    return it->second;
+  };
 
-  // go through the circuit list
+  // the circuits the reduction starts with
+  originals.clear ();
+  schedule.clear ();
+  results.clear ();
   for (circuit * c = root; c != NULL; c = (circuit *) c->getNext ()) {
-
-    // skip signal ports
-    if (c->getPort ()) continue;
-
-    // and each node in the circuit
+    if (c->getPort ()) {
+      // remember the signal ports connected to the nodes
+      for (int i = 0; i < c->getSize (); i++)
+	signal[id (c->getNode (i))] = c;
+      continue;
+    }
+    int b = originals.size ();
+    originals.push_back (c);
+    ports.emplace_back ();
+    slot.push_back (b);
     for (int i = 0; i < c->getSize (); i++) {
+      int n = id (c->getNode (i));
+      ports[b].push_back (n);
+      owners[n].push_back (b);
+    }
+  }
+  slots = originals.size ();
+  std::vector<bool> alive (ports.size (), true);
+
+  // a node joins two ports of circuits unless it is a signal port
+  auto joinable = [&] (int n) {
+    return signal[n] == NULL && owners[n].size () == 2;
+  };
+
+  // candidate joins ordered by interconnects first, then by cost
+  typedef std::tuple<int, int, int, int> cand_t;
+  std::priority_queue<cand_t, std::vector<cand_t>, std::greater<cand_t>> queue;
+  auto candidate = [&] (int n) {
+    int a = owners[n][0], b = owners[n][1];
+    if (a == b) {
+      queue.emplace (0, ports[a].size () - 2, 0, n);
+      return;
+    }
+    int shared = 0;
+    for (int m : ports[a])
+      if (joinable (m) && owners[m][0] != owners[m][1] &&
+	  (owners[m][0] == b || owners[m][1] == b)) shared++;
+    int size = ports[a].size () + ports[b].size ();
+    queue.emplace (1, size - 2 * shared, size - 2, n);
+  };
+  for (int n = 0; n < (int) owners.size (); n++)
+    if (joinable (n)) candidate (n);
+
+  while (!queue.empty ()) {
+    int n = std::get<3> (queue.top ());
+    queue.pop ();
+    if (!joinable (n)) continue;
+    int a = owners[n][0], b = owners[n][1];
+    if (!alive[a] || !alive[b]) continue;
+
+    // join the circuits and collect the remaining nodes
+    spjoin_t join;
+    std::vector<int> nodes;
+    join.s = slot[a];
+    join.t = slot[b];
+    join.k = std::find (ports[a].begin (), ports[a].end (), n) -
+      ports[a].begin ();
+    if (a != b) {
+      join.l = std::find (ports[b].begin (), ports[b].end (), n) -
+	ports[b].begin ();
+    } else {
+      join.l = std::find (ports[a].begin () + join.k + 1, ports[a].end (), n) -
+	ports[a].begin ();
+    }
+    for (int i = 0; i < (int) ports[a].size (); i++)
+      if (i != join.k && (a != b || i != join.l)) nodes.push_back (ports[a][i]);
+    if (a != b) {
+      for (int i = 0; i < (int) ports[b].size (); i++)
+	if (i != join.l) nodes.push_back (ports[b][i]);
+    }
+    join.size = nodes.size ();
+    owners[n].clear ();
+
+    // assign a buffer to the result and release the consumed ones
+    if (free.empty ()) {
+      join.r = slots++;
+    } else {
+      join.r = free.back ();
+      free.pop_back ();
+    }
+    free.push_back (slot[a]);
+    if (a != b) free.push_back (slot[b]);
+    schedule.push_back (join);
+
+    int r = ports.size ();
+    alive[a] = alive[b] = false;
+    alive.push_back (true);
+    slot.push_back (join.r);
+    for (int m : nodes)
+      for (auto & o : owners[m])
+	if (o == a || o == b) o = r;
+    ports.push_back (std::move (nodes));
+    for (int m : ports[r])
+      if (joinable (m)) candidate (m);
+  }
 
-      // find duplicate node
-      if ((cand = subnet->findConnectedCircuitNode (c->getNode (i))) != NULL) {
+#if DEBUG
+  double ops = 0;
+  for (auto & j : schedule) ops += (double) j.size * j.size;
+  logprint (LOG_STATUS, "NOTIFY: %s: %d joins using %d buffers, %g "
+	    "S-parameters per frequency\n", getName (),
+	    (int) schedule.size (), slots, ops);
+#endif
 
-	// save both candidates
-	c1 = c; c2 = cand->getCircuit ();
-	// connected
-	if (c1 != c2) {
-	  if (c1->getSize () + c2->getSize () - 2 < ports) {
-	    ports = c1->getSize () + c2->getSize () - 2;
-	    cand1 = c1; cand2 = c2; n1 = c1->getNode (i); n2 = cand;
-	  }
-	}
-	// interconnect
-	else {
-	  if (c1->getSize () - 2 < ports) {
-	    ports = c1->getSize () - 2;
-	    cand1 = c1; cand2 = c2; n1 = c1->getNode (i); n2 = cand;
-	  }
-	}
+  // the S-parameters of the remaining circuits, in the order of the
+  // circuit list of the reduced network
+  std::vector<int> remaining;
+  for (int b = ports.size () - 1; b >= (int) originals.size (); b--)
+    if (alive[b]) remaining.push_back (b);
+  for (int b = 0; b < (int) originals.size (); b++)
+    if (alive[b]) remaining.push_back (b);
+  noiseZ0 = circuit::z0;
+  for (int b : remaining) {
+    for (int i = 0; i < (int) ports[b].size (); i++) {
+      for (int j = 0; j < (int) ports[b].size (); j++) {
+	addResult (slot[b], i, j, signal[ports[b][i]], signal[ports[b][j]]);
       }
     }
   }
-#endif /* !SORTED_LIST */
+}
+
+/* The S-parameters of the nodal engine are those of all pairs of
+   signal ports. */
+void spsolver::createResults (spnodal * nodal) {
+  results.clear ();
+  noiseZ0 = circuit::z0;
+  for (int i = 0; i < nodal->countPorts (); i++) {
+    for (int j = 0; j < nodal->countPorts (); j++) {
+      addResult (0, i, j, nodal->getPort (i), nodal->getPort (j));
+    }
+  }
+}
 
-  // found a connection ?
-  if (cand1 != NULL && cand2 != NULL) {
+/* Adds the S-parameter of the given entry of a matrix to the list of
+   results.  The signal ports determine its name and whether it is
+   required to compute the noise parameters. */
+void spsolver::addResult (int c, int i, int j, circuit * sig_i,
+			  circuit * sig_j) {
+  int ni = getPropertyInteger ("NoiseIP");
+  int no = getPropertyInteger ("NoiseOP");
+
+  // generate the appropriate variable name
+  int res_i = sig_i->getPropertyInteger ("Num");
+  int res_j = sig_j->getPropertyInteger ("Num");
+  spresult_t r = { c, i, j, createSP (res_i, res_j), -1 };
+
+  // remember the entries of the noise matrices if requested
+  if (noise &&
+      (res_i == ni || res_i == no) && (res_j == ni || res_j == no)) {
+    if (ni == res_i) {
+      // assign input port impedance
+      noiseZ0 = sig_i->getPropertyDouble ("Z");
+    }
+    int ro = (res_i == ni) ? 0 : 1;
+    int co = (res_j == ni) ? 0 : 1;
+    r.noise = co + ro * 2;
+  }
+  results.push_back (r);
+}
+
+/* Reduces the network for a single frequency by replaying the
+   schedule of joins.  The given buffers hold the matrices of the
+   original circuits and receive the ones of the joined circuits. */
+void spsolver::reduce (std::vector<spmatrix_t> & m) {
+  for (auto & j : schedule) {
+    spmatrix_t & r = m[j.r];
+    r.init (j.size, noise);
     // connected
-    if (cand1 != cand2) {
-#if DEBUG && 0
-      logprint (LOG_STATUS, "DEBUG: connected node (%s): %s - %s\n",
-		n1->getName (), cand1->getName (), cand2->getName ());
-#endif /* DEBUG */
-      result = connectedJoin (n1, n2);
-      if (noise) noiseConnect (result, n1, n2);
-      subnet->reducedCircuit (result);
-#if SORTED_LIST
-      nlist->remove (cand1);
-      nlist->remove (cand2);
-      nlist->insert (result);
-#endif /* SORTED_LIST */
-      subnet->removeCircuit (cand1);
-      subnet->removeCircuit (cand2);
-      subnet->insertCircuit (result);
-      result->setOriginal (0);
+    if (j.s != j.t) {
+      connectedJoin (r, m[j.s], m[j.t], j.k, j.l);
+      if (noise) noiseConnect (r, m[j.s], m[j.t], j.k, j.l);
     }
     // interconnect
     else {
-#if DEBUG && 0
-      logprint (LOG_STATUS, "DEBUG: interconnected node (%s): %s\n",
-		n1->getName (), cand1->getName ());
-#endif
-      result = interconnectJoin (n1, n2);
-      if (noise) noiseInterconnect (result, n1, n2);
-      subnet->reducedCircuit (result);
-#if SORTED_LIST
-      nlist->remove (cand1);
-      nlist->insert (result);
-#endif /* SORTED_LIST */
-      subnet->removeCircuit (cand1);
-      subnet->insertCircuit (result);
-      result->setOriginal (0);
+      interconnectJoin (r, m[j.s], j.k, j.l);
+      if (noise) noiseInterconnect (r, m[j.s], j.k, j.l);
     }
   }
 }
@@ -528,21 +619,27 @@ void spsolver::init (void) {
   circuit * root = subnet->getRoot ();
   for (circuit * c = root; c != NULL; c = (circuit *) c->getNext ()) {
     if (c->isNonLinear ()) c->calcOperatingPoints ();
+    c->setRealMNA (false);
     c->initSP ();
     if (noise) c->initNoiseSP ();
   }
 }
 
-/* This is the netlist solver.  It prepares the circuit list for each
-   requested frequency and solves it then. */
+/* This is the netlist solver.  It prepares the circuit list and the
+   schedule of the reduction (or the MNA matrix of the nodal engine)
+   and then solves the network for each requested frequency.  The
+   frequencies are independent of each other: each one is solved on
+   its own copy of the matrices, on several threads if requested.
+   Only the evaluation of the circuits is done under a lock as these
+   hold the matrices.  The results are saved in sweep order. */
 int spsolver::solve (void) {
-  double freq;
-  int ports;
+  spnodal * nodal = NULL;
   runs++;
 
   // fetch simulation properties
   saveCVs |= !strcmp (getPropertyString ("saveCVs"), "yes") ? SAVE_CVS : 0;
   saveCVs |= !strcmp (getPropertyString ("saveAll"), "yes") ? SAVE_ALL : 0;
+  threads = getPropertyInteger ("Threads");
 
   // run additional noise analysis ?
   noise = !strcmp (getPropertyString ("Noise"), "yes") ? 1 : 0;
@@ -552,49 +649,171 @@ int spsolver::solve (void) {
     swp = createSweep ("frequency");
   }
 
-  init ();
-  insertConnections ();
-
-#if SORTED_LIST
-#if DEBUG
-  logprint (LOG_STATUS, "NOTIFY: %s: creating sorted nodelist for "
-	    "SP analysis\n", getName ());
-#endif
-  nlist = new nodelist (subnet);
-  nlist->sort ();
-#endif /* SORTED_LIST */
+  if (!strcmp (getPropertyString ("Engine"), "nodal")) {
+    const char * algo = getPropertyString ("Solver");
+    int solver = ALGO_LU_DECOMPOSITION;
+    if (!strcmp (algo, "SparseLU"))
+      solver = ALGO_LU_DECOMPOSITION_SPARSE;
+    else if (!strcmp (algo, "BlockedLU"))
+      solver = ALGO_LU_DECOMPOSITION_BLOCKED;
+    else if (!strcmp (algo, "MixedLU"))
+      solver = ALGO_LU_DECOMPOSITION_MIXED;
+    nodal = new spnodal (subnet, getName (), noise, solver);
+    nodal->init ();
+    createResults (nodal);
+  }
+  else {
+    init ();
+    insertConnections ();
+    createSchedule ();
+  }
 
 #if DEBUG
   logprint (LOG_STATUS, "NOTIFY: %s: solving SP netlist\n", getName ());
 #endif
 
+  const int points = swp->getSize ();
+  std::vector<double> freqs (points);
   swp->reset ();
-  for (int i = 0; i < swp->getSize (); i++) {
-    freq = swp->next ();
-
-    ports = subnet->countNodes ();
-    subnet->setReduced (0);
-    calc (freq);
-
+  for (int i = 0; i < points; i++) freqs[i] = swp->next ();
+
+  std::mutex lock;
+  std::vector<int> todo;
+  std::function<void (int, sppoint_t &)> store;
+  size_t next;
+
+  auto worker = [&] () {
+    std::vector<spmatrix_t> m (slots);
+    spnodal::system_t sys;
+    eqnsys<nr_complex_t> eqns;
+    tmatrix<nr_complex_t> S, N;
+    for (;;) {
+      int i;
+      sppoint_t p;
+      {
+	std::lock_guard<std::mutex> guard (lock);
+	if (next >= todo.size ()) break;
+	i = todo[next++];
 #if DEBUG && 0
-    logprint (LOG_STATUS, "NOTIFY: %s: solving netlist for f = %e\n",
-	      getName (), (double) freq);
+	logprint (LOG_STATUS, "NOTIFY: %s: solving netlist for f = %e\n",
+		  getName (), (double) freqs[i]);
 #endif
+	// evaluate the circuits and copy their matrices
+	if (nodal) {
+	  nodal->assemble (freqs[i], sys);
+	}
+	else {
+	  calc (freqs[i]);
+	  for (size_t n = 0; n < originals.size (); n++) {
+	    circuit * c = originals[n];
+	    m[n].init (c->getSize (), noise);
+	    for (int r = 0; r < c->getSize (); r++) {
+	      for (int k = 0; k < c->getSize (); k++) {
+		m[n].setS (r, k, c->getS (r, k));
+		if (noise) m[n].setN (r, k, c->getN (r, k));
+	      }
+	    }
+	  }
+	}
+	if (saveCVs & SAVE_CVS) calcCharacteristics (freqs[i], p.cvs);
+      }
 
-    while (ports > subnet->getPorts ()) {
-      reduce ();
-      ports -= 2;
+      // solve the nodal equations or reduce the network
+      if (nodal) {
+	nodal->solve (sys, eqns, S, N);
+	for (auto & r : results) {
+	  p.S.push_back (S.get (r.i, r.j));
+	  if (r.noise >= 0) {
+	    p.noise_c[r.noise] = N.get (r.i, r.j);
+	    p.noise_s[r.noise] = S.get (r.i, r.j);
+	  }
+	}
+      }
+      else {
+	reduce (m);
+	for (auto & r : results) {
+	  p.S.push_back (m[r.c].getS (r.i, r.j));
+	  if (r.noise >= 0) {
+	    p.noise_c[r.noise] = m[r.c].getN (r.i, r.j);
+	    p.noise_s[r.noise] = m[r.c].getS (r.i, r.j);
+	  }
+	}
+      }
+
+      std::lock_guard<std::mutex> guard (lock);
+      if (estack.top ()) estack.print ();
+      store (i, p);
+    }
+  };
+
+  // solves the points to do on the requested number of threads
+  auto run = [&] () {
+    std::vector<std::thread> workers;
+    next = 0;
+    for (int t = 1; t < std::min (threads, (int) todo.size ()); t++)
+      workers.emplace_back (worker);
+    worker ();
+    for (auto & w : workers) w.join ();
+  };
+
+  if (!strcmp (getPropertyString ("Adaptive"), "yes") && points > 1) {
+    /* fit the S-parameters, the noise correlations and the
+       characteristic values of the circuits */
+    adaptsweep adapt (freqs, getPropertyDouble ("AdaptiveTol"));
+    std::vector<std::string> cvs;
+    store = [&] (int i, sppoint_t & p) {
+      std::vector<nr_complex_t> v (p.S);
+      if (noise) {
+	v.insert (v.end (), p.noise_s, p.noise_s + 4);
+	v.insert (v.end (), p.noise_c, p.noise_c + 4);
+      }
+      if (cvs.empty ())
+	for (auto & cv : p.cvs) cvs.push_back (cv.first);
+      for (auto & cv : p.cvs) v.push_back (cv.second);
+      adapt.add (i, v);
+    };
+    while (!(todo = adapt.next ()).empty ()) run ();
+    logprint (LOG_STATUS, "NOTIFY: %s: adaptive sweep solved %d of %d "
+	      "frequency points, estimated error %g\n", getName (),
+	      adapt.countSolved (), points, adapt.getError ());
+
+    std::vector<nr_complex_t> v;
+    for (int i = 0; i < points; i++) {
+      sppoint_t p;
+      size_t k = results.size ();
+      adapt.evaluate (i, v);
+      p.S.assign (v.begin (), v.begin () + k);
+      if (noise) {
+	for (int n = 0; n < 4; n++) p.noise_s[n] = v[k++];
+	for (int n = 0; n < 4; n++) p.noise_c[n] = v[k++];
+      }
+      for (auto & name : cvs) p.cvs.emplace_back (name, real (v[k++]));
+      saveResults (freqs[i], p);
     }
+  }
+  else {
+    // save the frequencies solved so far in sweep order
+    std::map<int, sppoint_t> solved;
+    int saved = 0;
+    for (int i = 0; i < points; i++) todo.push_back (i);
+    store = [&] (int i, sppoint_t & p) {
+      solved.emplace (i, std::move (p));
+      for (auto it = solved.begin ();
+	   it != solved.end () && it->first == saved;
+	   it = solved.erase (it), saved++) {
+	saveResults (freqs[saved], it->second);
+      }
+    };
+    run ();
+  }
 
-    saveResults (freq);
-    subnet->getDroppedCircuits (nlist);
-    subnet->deleteUnusedCircuits (nlist);
-    if (saveCVs & SAVE_CVS) saveCharacteristics (freq);
+  if (nodal) {
+    nodal->finish ();
+    delete nodal;
+  }
+  else {
+    dropConnections ();
   }
-  dropConnections ();
-#if SORTED_LIST
-  delete nlist; nlist = NULL;
-#endif
   return 0;
 }
 
@@ -936,17 +1155,8 @@ void spsolver::dropDifferentialPort (circuit * c) {
 
 /* This function saves the results of a single solve() functionality
    (for the given frequency) into the output dataset. */
-void spsolver::saveResults (double freq) {
-
+void spsolver::saveResults (double freq, sppoint_t & p) {
   vector * f;
-  node * sig_i, * sig_j;
-  char * n;
-  int res_i, res_j;
-  circuit * root = subnet->getRoot ();
-
-  // temporary noise matrices and input port impedance
-  nr_complex_t noise_c[4], noise_s[4];
-  double z0 = circuit::z0;
 
   // add current frequency to the dependency of the output dataset
   if ((f = data->findDependency ("frequency")) == NULL) {
@@ -955,49 +1165,19 @@ void spsolver::saveResults (double freq) {
   }
   if (runs == 1) f->add (freq);
 
-  // go through the list of remaining circuits
-  for (circuit * c = root; c != NULL; c = (circuit *) c->getNext ()) {
-    // skip signals
-    if (!c->getPort ()) {
-      // handle each s-parameter
-      for (int i = 0; i < c->getSize (); i++) {
-	for (int j = 0; j < c->getSize (); j++) {
-
-	  // generate the appropriate variable name
-	  sig_i = subnet->findConnectedNode (c->getNode (i));
-	  sig_j = subnet->findConnectedNode (c->getNode (j));
-	  res_i = sig_i->getCircuit()->getPropertyInteger ("Num");
-	  res_j = sig_j->getCircuit()->getPropertyInteger ("Num");
-	  n = createSP (res_i, res_j);
-
-	  // add variable data item to dataset
-	  saveVariable (n, c->getS (i, j), f);
-
-	  // if noise analysis is requested
-	  if (noise) {
-	    int ro, co;
-	    int ni = getPropertyInteger ("NoiseIP");
-	    int no = getPropertyInteger ("NoiseOP");
-	    if ((res_i == ni || res_i == no) && (res_j == ni || res_j == no)) {
-	      if (ni == res_i) {
-		// assign input port impedance
-		z0 = sig_i->getCircuit()->getPropertyDouble ("Z");
-	      }
-	      ro = (res_i == ni) ? 0 : 1;
-	      co = (res_j == ni) ? 0 : 1;
-	      // save results in temporary data items
-	      noise_c[co + ro * 2] = c->getN (i, j);
-	      noise_s[co + ro * 2] = c->getS (i, j);
-	    }
-	  }
-	}
-      }
-    }
+  // add variable data items to dataset
+  for (size_t n = 0; n < results.size (); n++) {
+    saveVariable (results[n].name, p.S[n], f);
   }
 
   // finally compute and save noise parameters
   if (noise) {
-    saveNoiseResults (noise_s, noise_c, z0, f);
+    saveNoiseResults (p.noise_s, p.noise_c, noiseZ0, f);
+  }
+
+  // characteristic values of the circuits
+  for (auto & cv : p.cvs) {
+    saveVariable (cv.first, cv.second, f);
   }
 }
 
@@ -1045,27 +1225,24 @@ char * spsolver::createSP (int i, int j) {
   return matvec::createMatrixString ("S", i - 1, j - 1);
 }
 
-/* Create an appropriate variable name for characteristic values.  The
-   caller is responsible to free() the returned string. */
-const char * spsolver::createCV (const std::string &c, const std::string &n) {
-  return (c+"."+n).c_str();
+// Create an appropriate variable name for characteristic values.
+std::string spsolver::createCV (const std::string &c, const std::string &n) {
+  return c + "." + n;
 }
 
 /* Goes through the list of circuit objects and runs its
-   saveCharacteristics() function.  Then puts these values into the
-   dataset. */
-void spsolver::saveCharacteristics (double freq) {
+   saveCharacteristics() function.  Then collects these values for
+   the dataset. */
+void spsolver::calcCharacteristics (double freq,
+				    std::vector<std::pair<std::string, double>> & cvs) {
   circuit * root = subnet->getRoot ();
-  const char * n;
-  vector * f = data->findDependency ("frequency");
   for (circuit * c = root; c != NULL; c = (circuit *) c->getNext ()) {
     c->saveCharacteristics (freq);
     if (!c->getSubcircuit ().empty() && !(saveCVs & SAVE_ALL)) continue;
     c->calcCharacteristics (freq);
     for (auto ps: c->getCharacteristics ()) {
       qucs::pair &p = ps.second;
-      n = createCV (c->getName (), p.getName ());
-      saveVariable (n, p.getValue (), f);
+      cvs.emplace_back (createCV (c->getName (), p.getName ()), p.getValue ());
     }
   }
 }
@@ -1084,6 +1261,13 @@ PROP_OPT [] = {
   { "Values", PROP_LIST, { 10, PROP_NO_STR }, PROP_POS_RANGE },
   { "saveCVs", PROP_STR, { PROP_NO_VAL, "no" }, PROP_RNG_YESNO },
   { "saveAll", PROP_STR, { PROP_NO_VAL, "no" }, PROP_RNG_YESNO },
+  { "Threads", PROP_INT, { 1, PROP_NO_STR }, PROP_RNGII (1, 256) },
+  { "Engine", PROP_STR, { PROP_NO_VAL, "reduction" },
+    PROP_RNG_STR2 ("reduction", "nodal") },
+  { "Solver", PROP_STR, { PROP_NO_VAL, "CroutLU" },
+    PROP_RNG_STR4 ("CroutLU", "SparseLU", "BlockedLU", "MixedLU") },
+  { "Adaptive", PROP_STR, { PROP_NO_VAL, "no" }, PROP_RNG_YESNO },
+  { "AdaptiveTol", PROP_REAL, { 1e-6, PROP_NO_STR }, PROP_RNG_X01I },
   PROP_NO_PROP };
 struct define_t spsolver::anadef =
   { "SP", 0, PROP_ACTION, PROP_NO_SUBSTRATE, PROP_LINEAR, PROP_DEF };
@@ -23,6 +23,8 @@
 #define __SPSOLVER_H__
 
 #include <string>
+#include <utility>
+#include <vector>
 
 namespace qucs {
 
@@ -31,7 +33,24 @@ class circuit;
 class node;
 class vector;
 class sweep;
-class nodelist;
+class spnodal;
+
+/* The S-parameter and noise wave correlation matrices of a circuit
+   while reducing the network for a single frequency. */
+struct spmatrix_t {
+  int size = 0;
+  std::vector<nr_complex_t> S, N;
+  void init(int n, int noise) {
+    size = n;
+    S.assign(n * n, 0.0);
+    N.assign(noise ? n * n : 0, 0.0);
+  }
+  nr_complex_t getS(int r, int c) const { return S[r * size + c]; }
+  nr_complex_t getN(int r, int c) const { return N[r * size + c]; }
+  void setS(int r, int c, nr_complex_t z) { S[r * size + c] = z; }
+  void setN(int r, int c, nr_complex_t z) { N[r * size + c] = z; }
+  int getSize() const { return size; }
+};
 
 class spsolver final : public analysis {
 public:
@@ -42,7 +61,10 @@ public:
   int solve() override;
   void calc(double);
   void init();
-  void reduce();
+  void createSchedule();
+  void createResults(spnodal *);
+  void addResult(int, int, int, circuit *, circuit *);
+  void reduce(std::vector<spmatrix_t> &);
   void insertConnections();
   void insertDifferentialPorts();
   void insertTee(node **, const char *);
@@ -50,15 +72,14 @@ public:
   void insertConnectors(node *);
   void insertOpen(node *);
   void insertGround(node *);
-  circuit *interconnectJoin(node *, node *);
-  circuit *connectedJoin(node *, node *);
-  void noiseConnect(circuit *, node *, node *);
-  void noiseInterconnect(circuit *, node *, node *);
-  void saveResults(double);
+  void interconnectJoin(spmatrix_t &, const spmatrix_t &, int, int);
+  void connectedJoin(spmatrix_t &, const spmatrix_t &, const spmatrix_t &, int, int);
+  void noiseConnect(spmatrix_t &, const spmatrix_t &, const spmatrix_t &, int, int);
+  void noiseInterconnect(spmatrix_t &, const spmatrix_t &, int, int);
   void saveNoiseResults(nr_complex_t[4], nr_complex_t[4], double, vector *);
   char *createSP(int, int);
-  const char *createCV(const std::string &c, const std::string &n);
-  void saveCharacteristics(double);
+  std::string createCV(const std::string &c, const std::string &n);
+  void calcCharacteristics(double, std::vector<std::pair<std::string, double>> &);
   void dropTee(circuit *);
   void dropCross(circuit *);
   void dropOpen(circuit *);
@@ -66,12 +87,42 @@ public:
   void dropDifferentialPort(circuit *);
   void dropConnections();
 
+private:
+  /* A join of two ports of one (interconnect) or two circuits.  The
+     circuits are given by the buffers holding their matrices during
+     the reduction. */
+  struct spjoin_t {
+    int s, t; // joined circuits, t == s for an interconnect
+    int k, l; // joined ports
+    int r;    // resulting circuit
+    int size; // number of ports of the resulting circuit
+  };
+  /* An S-parameter of the reduced network to be saved. */
+  struct spresult_t {
+    int c, i, j;      // buffer of the circuit and ports
+    std::string name; // variable name
+    int noise;        // index into the noise matrices, -1 if none
+  };
+  /* The results of a single frequency. */
+  struct sppoint_t {
+    std::vector<nr_complex_t> S;
+    nr_complex_t noise_s[4], noise_c[4];
+    std::vector<std::pair<std::string, double>> cvs;
+  };
+  void saveResults(double, sppoint_t &);
+
 private:
   int tees, crosses, grounds, opens;
   int noise;
   int saveCVs;
+  int threads;
+  // circuits the reduction starts with and the sequence of joins
+  std::vector<circuit *> originals;
+  std::vector<spjoin_t> schedule;
+  std::vector<spresult_t> results;
+  int slots; // number of matrix buffers
+  double noiseZ0;
   sweep *swp;
-  nodelist *nlist;
   circuit *gnd;
 };
 
@@ -39,6 +39,8 @@
 
 #define STEPDEBUG 0   // set to zero for release
 
+#define TR_SPILL_CHUNK 1024 // results per chunk written when streaming
+
 namespace qucs {
 
 using namespace transient;
@@ -51,6 +53,8 @@ trsolver::trsolver() {
     solution[i] = nullptr;
   }
   hist = nullptr;
+  stream = false;
+  linear = false;
 }
 
 trsolver::trsolver(const std::string &n) : nasolver(n) {
@@ -61,6 +65,8 @@ trsolver::trsolver(const std::string &n) : nasolver(n) {
     solution[i] = nullptr;
   }
   hist = nullptr;
+  stream = false;
+  linear = false;
 }
 
 trsolver::~trsolver() {
@@ -79,10 +85,20 @@ int trsolver::solve() {
   int error = 0, convError = 0;
   const char *const solver = getPropertyString("Solver");
   const bool initialDC = !strcmp(getPropertyString("initialDC"), "yes") ? true : false;
+  bypass = !strcmp(getPropertyString("Bypass"), "yes");
+  bypassed = 0;
+  reuseMax = getPropertyInteger("JacobianReuse");
+  condense = !strcmp(getPropertyString("Condense"), "yes");
+  setOrdering(getPropertyString("Ordering"));
+  stream = !strcmp(getPropertyString("Stream"), "yes");
+  linear = !subnet->isNonLinear();
+  factorizations = 0;
 
   runs++;
   double saveCurrent = current = 0;
   stepDelta = -1;
+  breakpoint = -1;
+  restart = 0;
   converged = 0;
   statRejected = statSteps = statIterations = statConvergence = 0;
 
@@ -96,6 +112,16 @@ int trsolver::solve() {
     eqnAlgo = ALGO_QR_DECOMPOSITION_LS;
   else if (!strcmp(solver, "GolubSVD"))
     eqnAlgo = ALGO_SV_DECOMPOSITION;
+  else if (!strcmp(solver, "SparseLU"))
+    eqnAlgo = ALGO_LU_DECOMPOSITION_SPARSE;
+  else if (!strcmp(solver, "BlockedLU"))
+    eqnAlgo = ALGO_LU_DECOMPOSITION_BLOCKED;
+  else if (!strcmp(solver, "GMRES"))
+    eqnAlgo = ALGO_GMRES;
+  else if (!strcmp(solver, "BiCGStab"))
+    eqnAlgo = ALGO_BICGSTAB;
+  krylovTol = getPropertyDouble("KrylovTol");
+  krylovMaxIter = getPropertyInteger("KrylovMaxIter");
 
   // Perform initial DC analysis.
   if (initialDC) {
@@ -227,7 +253,7 @@ int trsolver::solve() {
       }
 
       // check whether Jacobian matrix is still non-singular
-      if (!A->isFinite()) {
+      if (!isMatrixFinite()) {
         logprint(LOG_ERROR,
                  "ERROR: %s: Jacobian singular at t = %.3e, "
                  "aborting %s analysis\n",
@@ -244,7 +270,7 @@ int trsolver::solve() {
       // Now advance in time or not...
       if (running > 1) {
         adjustDelta(time); // Will call `nextStates()`.
-        adjustOrder();
+        adjustOrder(restart);
       } else {
         fillStates();
         nextStates();
@@ -283,6 +309,12 @@ int trsolver::solve() {
            "NOTIFY: %s: average NR-iterations %g, "
            "%d non-convergences\n",
            getName(), statIterations / statSteps, statConvergence);
+  if (bypass) {
+    logprint(LOG_STATUS, "NOTIFY: %s: %d device evaluations bypassed\n", getName(), bypassed);
+  }
+  if (reuseMax > 0 || linear) {
+    logprint(LOG_STATUS, "NOTIFY: %s: %d matrix factorizations\n", getName(), factorizations);
+  }
 
   return 0;
 }
@@ -363,6 +395,17 @@ void trsolver::predictBashford() {
 int trsolver::corrector() {
   logprint(LOG_STATUS, "NOTIFY: %s: trsolver::corrector()\n", getName());
 
+  // the matrix of a linear netlist changes with the step size only
+  if (linear) {
+    iterations = 1;
+    const int error = solve_linear_cached(delta);
+    // evaluate the circuits once more, their states must hold the
+    // charges and fluxes of the solution
+    if (!error) {
+      calculate();
+    }
+    return error;
+  }
   return solve_nonlinear();
 }
 
@@ -452,7 +495,13 @@ void trsolver::adjustDelta(double t) {
   const bool relaxTSR = !strcmp(getPropertyString("relaxTSR"), "yes") ? true : false;
 
   deltaOld = delta;
-  delta = checkDelta();
+  if (restart) {
+    // the predictor does not extrapolate across the breakpoint, keep the
+    // step size for the first step behind it
+    restart = 0;
+  } else {
+    delta = checkDelta();
+  }
   if (delta > deltaMax) {
     delta = deltaMax;
   }
@@ -499,6 +548,47 @@ void trsolver::adjustDelta(double t) {
     }
   }
 
+  // hit the discontinuities of the sources exactly unless rejecting
+  if (delta > 0.9 * deltaOld || good) {
+    // the step raster above lands on the requested time point
+    const bool raster = good && t > current;
+    if (breakpoint >= 0 && fabs(current - breakpoint) <= deltaMin) {
+      // the previous solutions do not extrapolate across the breakpoint,
+      // restart the integration behind it with a small first order step
+      const double next = nextBreakpoint(current);
+      delta = std::min(delta, 0.1 * std::min(deltaOld, next - current));
+      delta = std::max(delta, deltaMin);
+      stepDelta = -1.0;
+      breakpoint = -1.0;
+      restart = 1;
+      good = 1;
+    }
+    double tb = nextBreakpoint(current);
+    bool source = true;
+    if (fabs(tb - t) <= deltaMin) {
+      tb = t; // coincides with the requested time point
+    } else if (raster && t < tb) {
+      tb = t; // the requested time point must not be skipped
+      source = false;
+    }
+    if (current + delta >= tb - deltaMin) {
+      // land on the breakpoint
+      if (delta != tb - current) {
+        delta = tb - current;
+        stepDelta = -1.0;
+      }
+      if (source) {
+        breakpoint = tb;
+      }
+      good = 1;
+    } else if (current + 2 * delta > tb) {
+      // split the remaining distance evenly instead of leaving a tiny step
+      delta = (tb - current) / 2;
+      stepDelta = -1.0;
+      good = 1;
+    }
+  }
+
   // usual delta correction
   if (delta > 0.9 * deltaOld || good) {
     // accept current delta
@@ -522,6 +612,17 @@ void trsolver::adjustDelta(double t) {
   }
 }
 
+/* Returns the first discontinuity of the circuit's sources after the
+   given time (and not just behind it), the largest double if none. */
+double trsolver::nextBreakpoint(double t) {
+  double tb = std::numeric_limits<double>::max();
+  circuit *root = subnet->getRoot();
+  for (circuit *c = root; c != nullptr; c = c->getNext()) {
+    tb = std::min(tb, c->nextBreakpoint(t + deltaMin));
+  }
+  return tb;
+}
+
 /* Increase or reduces the current order of the integration method. */
 void trsolver::adjustOrder(int reduce) {
   if ((corrOrder < corrMaxOrder && !rejected) || reduce) {
@@ -595,6 +696,7 @@ void trsolver::initTR() {
   // tell circuits about the transient analysis
   circuit *c, *root = subnet->getRoot();
   for (c = root; c != nullptr; c = c->getNext()) {
+    c->setRealMNA(true);
     c->initTR();
     // Share the state with the circuit.
     c->setDelta(deltas); // ARA: Only used by the BJT model.
@@ -604,6 +706,7 @@ void trsolver::initTR() {
   }
   // also initialize created circuits
   for (c = root; c != nullptr; c = c->getPrev()) {
+    c->setRealMNA(true);
     c->initTR();
     // Share the state with the circuit.
     c->setDelta(deltas); // ARA: Only used by the BJT model.
@@ -619,15 +722,17 @@ void trsolver::calcTR(trsolver *self) {
 
   circuit *root = self->getNet()->getRoot();
   for (circuit *c = root; c != nullptr; c = c->getNext()) {
+    if (self->bypassCircuit(c))
+      continue;
     c->calcTR(self->current);
   }
 }
 
 void trsolver::initHistory(double t) {
   // initialize time vector
+  delete hist;
   hist = new history();
   hist->push_back(t);
-  hist->self();
   // initialize circuit histories
   double age = 0.0;
   circuit *root = subnet->getRoot();
@@ -697,6 +802,15 @@ void trsolver::saveAllResults(double time) {
     t->add(time);
   }
   saveResults("Vt", "It", 0, t);
+
+  // keep only the latest results in memory, the older ones go to disk
+  if (stream && !t->isSpilled()) {
+    t->setSpill(TR_SPILL_CHUNK);
+    for (qucs::vector *v = data->getVariables(); v != nullptr; v = v->getNext()) {
+      if (v->getOrigin() && !strcmp(v->getOrigin(), getName()))
+        v->setSpill(TR_SPILL_CHUNK);
+    }
+  }
 }
 
 PROP_REQ[] = {
@@ -724,8 +838,15 @@ PROP_OPT[] = {
     {"LTEfactor", PROP_REAL, {1, PROP_NO_STR}, PROP_RNGII(1, 16)},
     {"Temp", PROP_REAL, {26.85, PROP_NO_STR}, PROP_MIN_VAL(K)},
     {"Solver", PROP_STR, {PROP_NO_VAL, "CroutLU"}, PROP_RNG_SOL},
+    {"KrylovTol", PROP_REAL, {1e-12, PROP_NO_STR}, PROP_RNG_X01I},
+    {"KrylovMaxIter", PROP_INT, {0, PROP_NO_STR}, PROP_RNGII(0, 100000)},
     {"relaxTSR", PROP_STR, {PROP_NO_VAL, "no"}, PROP_RNG_YESNO},
     {"initialDC", PROP_STR, {PROP_NO_VAL, "yes"}, PROP_RNG_YESNO},
+    {"Bypass", PROP_STR, {PROP_NO_VAL, "no"}, PROP_RNG_YESNO},
+    {"JacobianReuse", PROP_INT, {0, PROP_NO_STR}, PROP_RNGII(0, 100)},
+    {"Condense", PROP_STR, {PROP_NO_VAL, "no"}, PROP_RNG_YESNO},
+    {"Ordering", PROP_STR, {PROP_NO_VAL, "none"}, PROP_RNG_STR3("none", "RCM", "MinDegree")},
+    {"Stream", PROP_STR, {PROP_NO_VAL, "no"}, PROP_RNG_YESNO},
     PROP_NO_PROP,
 };
 struct define_t trsolver::anadef = {"TR", 0, PROP_ACTION, PROP_NO_SUBSTRATE, PROP_LINEAR, PROP_DEF};
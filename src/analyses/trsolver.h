@@ -68,6 +68,7 @@ private:
   static void calcTR(trsolver *);
   void saveAllResults(double);
   double checkDelta();
+  double nextBreakpoint(double);
   void initHistory(double);
   void updateHistory(double);
   void saveHistory(circuit *);
@@ -89,13 +90,15 @@ private:
   double deltaMin;
   double deltaOld;
   double stepDelta;
-  int corrMethod0;  // user specified corrector method
-  int corrMethod;   // current corrector method
-  int predMethod;   // current predictor method
-  int corrMaxOrder; // maximum corrector order
-  int predMaxOrder; // maximum predictor order
-  int corrOrder;    // current corrector order
-  int predOrder;    // current predictor order
+  double breakpoint; // the source discontinuity the step lands on, negative if none
+  int restart;       // the integration restarts behind a breakpoint
+  int corrMethod0;   // user specified corrector method
+  int corrMethod;    // current corrector method
+  int predMethod;    // current predictor method
+  int corrMaxOrder;  // maximum corrector order
+  int predMaxOrder;  // maximum predictor order
+  int corrOrder;     // current corrector order
+  int predOrder;     // current predictor order
   int rejected;
   int converged;
   double current;
@@ -104,6 +107,8 @@ private:
   int statIterations;
   int statConvergence;
   history *hist;
+  bool stream; // spill the results to disk while running
+  bool linear; // solve the linear netlist without Newton iterations
 
   std::unordered_map<
       /* node or circuit name */ std::string,
@@ -64,6 +64,9 @@ int trsolver::dcAnalysis() {
 
   // Save the DC solution.
   storeDcSolution();
+  if (!error) {
+    storeContinuation();
+  }
 
   // Cleanup nodal analysis solver.
   solve_post();
@@ -81,6 +84,7 @@ void trsolver::initDC() {
 
   circuit *root = subnet->getRoot();
   for (circuit *c = root; c != nullptr; c = c->getNext()) {
+    c->setRealMNA(true);
     c->initDC();
   }
 }
@@ -91,6 +95,8 @@ void trsolver::calcDC(trsolver *self) {
 
   circuit *root = self->getNet()->getRoot();
   for (circuit *c = root; c != nullptr; c = c->getNext()) {
+    if (self->bypassCircuit(c))
+      continue;
     c->calcDC();
   }
 }
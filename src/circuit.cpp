@@ -45,6 +45,8 @@ circuit::circuit() : object(), integrator() {
   MatrixN = MatrixS = MatrixY = nullptr;
   MatrixB = MatrixC = MatrixD = nullptr;
   VectorQ = VectorE = VectorI = VectorV = VectorJ = nullptr;
+  RealY = RealB = RealC = RealD = nullptr;
+  RealE = RealI = RealV = RealJ = nullptr;
   MatrixQV = nullptr;
   VectorCV = VectorGV = nullptr;
   nodes = nullptr;
@@ -73,6 +75,8 @@ circuit::circuit(int s) : object(), integrator() {
   MatrixN = MatrixS = MatrixY = nullptr;
   MatrixB = MatrixC = MatrixD = nullptr;
   VectorQ = VectorE = VectorI = VectorV = VectorJ = nullptr;
+  RealY = RealB = RealC = RealD = nullptr;
+  RealE = RealI = RealV = RealJ = nullptr;
   MatrixQV = nullptr;
   VectorCV = VectorGV = nullptr;
   pacport = 0;
@@ -190,10 +194,24 @@ void circuit::allocMatrixN(int sources) {
   MatrixN = new nr_complex_t[(size + sources) * (size + sources)];
 }
 
-/* Allocates the matrix memory for the MNA matrices. */
+/* Allocates the matrix memory for the MNA matrices.  Depending on the
+   analysis the buffers hold either complex or real values. */
 void circuit::allocMatrixMNA() {
   freeMatrixMNA();
   if (size > 0) {
+    if (isRealMNA()) {
+      RealY = new double[size * size]();
+      RealI = new double[size]();
+      RealV = new double[size]();
+      if (vsources > 0) {
+        RealB = new double[vsources * size]();
+        RealC = new double[vsources * size]();
+        RealD = new double[vsources * vsources]();
+        RealE = new double[vsources]();
+        RealJ = new double[vsources]();
+      }
+      return;
+    }
     MatrixY = new nr_complex_t[size * size]; // ARA: Input matrix, conductances.
     VectorI = new nr_complex_t[size];        // ARA: Input vector, currents.
     VectorV = new nr_complex_t[size];        // ARA: Output vector, voltages.
@@ -209,55 +227,82 @@ void circuit::allocMatrixMNA() {
 
 /* Free()'s all memory used by the MNA matrices. */
 void circuit::freeMatrixMNA() {
-  if (MatrixY) {
-    delete[] MatrixY;
-    MatrixY = nullptr;
-  }
-  if (MatrixB) {
-    delete[] MatrixB;
-    MatrixB = nullptr;
-  }
-  if (MatrixC) {
-    delete[] MatrixC;
-    MatrixC = nullptr;
-  }
-  if (MatrixD) {
-    delete[] MatrixD;
-    MatrixD = nullptr;
-  }
-  if (VectorE) {
-    delete[] VectorE;
-    VectorE = nullptr;
-  }
-  if (VectorI) {
-    delete[] VectorI;
-    VectorI = nullptr;
-  }
-  if (VectorV) {
-    delete[] VectorV;
-    VectorV = nullptr;
-  }
-  if (VectorJ) {
-    delete[] VectorJ;
-    VectorJ = nullptr;
+  delete[] MatrixY;
+  delete[] MatrixB;
+  delete[] MatrixC;
+  delete[] MatrixD;
+  delete[] VectorE;
+  delete[] VectorI;
+  delete[] VectorV;
+  delete[] VectorJ;
+  MatrixY = MatrixB = MatrixC = MatrixD = nullptr;
+  VectorE = VectorI = VectorV = VectorJ = nullptr;
+  delete[] RealY;
+  delete[] RealB;
+  delete[] RealC;
+  delete[] RealD;
+  delete[] RealE;
+  delete[] RealI;
+  delete[] RealV;
+  delete[] RealJ;
+  RealY = RealB = RealC = RealD = nullptr;
+  RealE = RealI = RealV = RealJ = nullptr;
+}
+
+// Converts the given MNA buffer of n values to the other type.
+static void convertMNA(nr_complex_t *&cplx, double *&re, int n) {
+  if (re) {
+    cplx = new nr_complex_t[n];
+    for (int i = 0; i < n; i++)
+      cplx[i] = re[i];
+    delete[] re;
+    re = nullptr;
+  } else if (cplx) {
+    re = new double[n];
+    for (int i = 0; i < n; i++)
+      re[i] = real(cplx[i]);
+    delete[] cplx;
+    cplx = nullptr;
   }
 }
 
-void circuit::clearB() { memset(MatrixB, 0, sizeof(nr_complex_t) * size * vsources); }
+void circuit::setRealMNA(bool r) {
+  if (r == isRealMNA())
+    return;
+  MODFLAG(r, CIRCUIT_REALMNA);
+  convertMNA(MatrixY, RealY, size * size);
+  convertMNA(MatrixB, RealB, vsources * size);
+  convertMNA(MatrixC, RealC, vsources * size);
+  convertMNA(MatrixD, RealD, vsources * vsources);
+  convertMNA(VectorE, RealE, vsources);
+  convertMNA(VectorI, RealI, size);
+  convertMNA(VectorV, RealV, size);
+  convertMNA(VectorJ, RealJ, vsources);
+}
+
+// Clears the given MNA buffer, only one of both types is allocated.
+static void clearMNA(nr_complex_t *cplx, double *re, int n) {
+  if (re)
+    memset(re, 0, sizeof(double) * n);
+  else
+    memset(cplx, 0, sizeof(nr_complex_t) * n);
+}
+
+void circuit::clearB() { clearMNA(MatrixB, RealB, size * vsources); }
 
-void circuit::clearC() { memset(MatrixC, 0, sizeof(nr_complex_t) * size * vsources); }
+void circuit::clearC() { clearMNA(MatrixC, RealC, size * vsources); }
 
-void circuit::clearD() { memset(MatrixD, 0, sizeof(nr_complex_t) * vsources * vsources); }
+void circuit::clearD() { clearMNA(MatrixD, RealD, vsources * vsources); }
 
-void circuit::clearE() { memset(VectorE, 0, sizeof(nr_complex_t) * vsources); }
+void circuit::clearE() { clearMNA(VectorE, RealE, vsources); }
 
-void circuit::clearJ() { memset(VectorJ, 0, sizeof(nr_complex_t) * vsources); }
+void circuit::clearJ() { clearMNA(VectorJ, RealJ, vsources); }
 
-void circuit::clearI() { memset(VectorI, 0, sizeof(nr_complex_t) * size); }
+void circuit::clearI() { clearMNA(VectorI, RealI, size); }
 
-void circuit::clearV() { memset(VectorV, 0, sizeof(nr_complex_t) * size); }
+void circuit::clearV() { clearMNA(VectorV, RealV, size); }
 
-void circuit::clearY() { memset(MatrixY, 0, sizeof(nr_complex_t) * size * size); }
+void circuit::clearY() { clearMNA(MatrixY, RealY, size * size); }
 
 /* Sets the name and port number of one of the circuit's
    nodes.  It also tells the appropriate node about the circuit it
@@ -412,7 +457,12 @@ void circuit::setMatrixY(matrix y) {
   int c = y.getCols();
   // copy matrix elements
   if (r > 0 && c > 0 && r * c == size * size) {
-    memcpy(MatrixY, y.getData(), sizeof(nr_complex_t) * r * c);
+    if (RealY) {
+      for (int i = 0; i < r * c; i++)
+        RealY[i] = real(y.getData()[i]);
+    } else {
+      memcpy(MatrixY, y.getData(), sizeof(nr_complex_t) * r * c);
+    }
   }
 }
 
@@ -422,7 +472,7 @@ matrix circuit::getMatrixY() {
   matrix res(size);
   for (unsigned int i = 0; i < size; ++i)
     for (unsigned int j = 0; j < size; ++j)
-      res(i, j) = MatrixY[i * size + j];
+      res(i, j) = getY(i, j);
   return res;
 }
 
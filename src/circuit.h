@@ -51,6 +51,7 @@
   static struct define_t cirdef;                                                                   \
   static struct define_t *definition() { return &cirdef; }
 
+#include <limits>
 #include <map>
 #include <string>
 
@@ -69,6 +70,7 @@ enum circuit_flag {
   CIRCUIT_VARSIZE = 64,
   CIRCUIT_PROBE = 128,
   CIRCUIT_HISTORY = 256,
+  CIRCUIT_REALMNA = 512,
 };
 
 class node;
@@ -104,6 +106,10 @@ public:
 
   virtual void initTR() { allocMatrixMNA(); }
   virtual void calcTR(double) {}
+  /* Returns the time of the first discontinuity of the transient
+     excitation after the given time, e.g. the next corner of a pulse,
+     the largest double if there is none. */
+  virtual double nextBreakpoint(double) { return std::numeric_limits<double>::max(); }
 
   virtual void initAC() { allocMatrixMNA(); }
   virtual void calcAC(double) {}
@@ -242,15 +248,29 @@ public:
   /* Returns the noise-correlation-parameter at the given matrix position. */
   nr_complex_t getN(int r, int c) const { return MatrixN[c + r * (size + nsources)]; };
   /* Returns the circuits G-MNA matrix value depending on the port numbers. */
-  nr_complex_t getY(int r, int c) const { return MatrixY[r * size + c]; }
+  nr_complex_t getY(int r, int c) const {
+    return RealY ? RealY[r * size + c] : MatrixY[r * size + c];
+  }
   /* Returns the circuits B-MNA matrix value of the given voltage source built in the circuit
    * depending on the port number. */
-  nr_complex_t getB(int port, int nr) const { return MatrixB[(nr - vsource) * size + port]; }
+  nr_complex_t getB(int port, int nr) const {
+    return RealB ? RealB[(nr - vsource) * size + port] : MatrixB[(nr - vsource) * size + port];
+  }
   /* Returns the circuits C-MNA matrix value of the given voltage source built in the circuit
    * depending on the port number. */
-  nr_complex_t getC(int nr, int port) const { return MatrixC[(nr - vsource) * size + port]; }
+  nr_complex_t getC(int nr, int port) const {
+    return RealC ? RealC[(nr - vsource) * size + port] : MatrixC[(nr - vsource) * size + port];
+  }
   /* Returns the circuits D-MNA matrix value of the given voltage source built in the circuit. */
-  nr_complex_t getD(int r, int c) const { return MatrixD[(r - vsource) * vsources + c - vsource]; }
+  nr_complex_t getD(int r, int c) const {
+    return RealD ? RealD[(r - vsource) * vsources + c - vsource]
+                 : MatrixD[(r - vsource) * vsources + c - vsource];
+  }
+  /* The same entries of the real-valued storage, i.e. if isRealMNA(). */
+  double getRealY(int r, int c) const { return RealY[r * size + c]; }
+  double getRealB(int port, int nr) const { return RealB[(nr - vsource) * size + port]; }
+  double getRealC(int nr, int port) const { return RealC[(nr - vsource) * size + port]; }
+  double getRealD(int r, int c) const { return RealD[(r - vsource) * vsources + c - vsource]; }
   /* Returns the circuits C-HB matrix value depending on the port numbers. */
   nr_complex_t getQV(int r, int c) const { return MatrixQV[r * size + c]; }
   /* Returns the circuits GV-HB vector value depending on the port number. */
@@ -258,13 +278,19 @@ public:
   /* Returns the circuits CV-HB vector value depending on the port number. */
   nr_complex_t getCV(int port) const { return VectorCV[port]; }
   /* Returns the circuits E-MNA matrix value of the given voltage source built in the circuit. */
-  nr_complex_t getE(int nr) const { return VectorE[nr - vsource]; }
+  nr_complex_t getE(int nr) const {
+    return RealE ? RealE[nr - vsource] : VectorE[nr - vsource];
+  }
+  /* The same entry of the real-valued storage, i.e. if isRealMNA(). */
+  double getRealE(int nr) const { return RealE[nr - vsource]; }
   /* Returns the circuits I-MNA matrix value of the current source built in the circuit. */
-  nr_complex_t getI(int port) const { return VectorI[port]; }
+  nr_complex_t getI(int port) const { return RealI ? RealI[port] : VectorI[port]; }
+  /* The same entry of the real-valued storage, i.e. if isRealMNA(). */
+  double getRealI(int port) const { return RealI[port]; }
   /* Returns the circuits J-MNA matrix value of the given voltage source built in the circuit. */
-  nr_complex_t getJ(int nr) const { return VectorJ[nr]; }
+  nr_complex_t getJ(int nr) const { return RealJ ? RealJ[nr] : VectorJ[nr]; }
   /* Returns the circuits voltage value at the given port. */
-  nr_complex_t getV(int port) const { return VectorV[port]; }
+  nr_complex_t getV(int port) const { return RealV ? RealV[port] : VectorV[port]; }
   /* Returns the circuits Q-HB vector value. */
   nr_complex_t getQ(int port) const { return VectorQ[port]; }
 
@@ -273,19 +299,77 @@ public:
   /* Sets the noise-correlation-parameter at the given matrix position. */
   void setN(int r, int c, nr_complex_t z) { MatrixN[c + r * (size + nsources)] = z; }
   /* Sets the circuits G-MNA matrix value depending on the port numbers. */
-  void setY(int r, int c, nr_complex_t y) { MatrixY[r * size + c] = y; }
+  void setY(int r, int c, nr_complex_t y) {
+    if (RealY)
+      RealY[r * size + c] = real(y);
+    else
+      MatrixY[r * size + c] = y;
+  }
+  /* Same as above with different argument type. */
+  void setY(int r, int c, double y) {
+    if (RealY)
+      RealY[r * size + c] = y;
+    else
+      MatrixY[r * size + c] = y;
+  }
   /* Modifies the circuits G-MNA matrix value depending on the port numbers. */
-  void addY(int r, int c, nr_complex_t y) { MatrixY[r * size + c] += y; }
+  void addY(int r, int c, nr_complex_t y) {
+    if (RealY)
+      RealY[r * size + c] += real(y);
+    else
+      MatrixY[r * size + c] += y;
+  }
   /* Modifies the circuits G-MNA matrix value depending on the port numbers. */
-  void addY(int r, int c, double y) { MatrixY[r * size + c] += y; }
+  void addY(int r, int c, double y) {
+    if (RealY)
+      RealY[r * size + c] += y;
+    else
+      MatrixY[r * size + c] += y;
+  }
   /* Sets the circuits B-MNA matrix value of the given voltage source built in the circuit depending
    * on the port number. */
-  void setB(int port, int nr, nr_complex_t z) { MatrixB[nr * size + port] = z; }
+  void setB(int port, int nr, nr_complex_t z) {
+    if (RealB)
+      RealB[nr * size + port] = real(z);
+    else
+      MatrixB[nr * size + port] = z;
+  }
+  /* Same as above with different argument type. */
+  void setB(int port, int nr, double z) {
+    if (RealB)
+      RealB[nr * size + port] = z;
+    else
+      MatrixB[nr * size + port] = z;
+  }
   /* Sets the circuits C-MNA matrix value of the given voltage source built in the circuit depending
    * on the port number. */
-  void setC(int nr, int port, nr_complex_t z) { MatrixC[nr * size + port] = z; }
+  void setC(int nr, int port, nr_complex_t z) {
+    if (RealC)
+      RealC[nr * size + port] = real(z);
+    else
+      MatrixC[nr * size + port] = z;
+  }
+  /* Same as above with different argument type. */
+  void setC(int nr, int port, double z) {
+    if (RealC)
+      RealC[nr * size + port] = z;
+    else
+      MatrixC[nr * size + port] = z;
+  }
   /* Sets the circuits D-MNA matrix value of the given voltage source built in the circuit. */
-  void setD(int r, int c, nr_complex_t z) { MatrixD[r * vsources + c] = z; }
+  void setD(int r, int c, nr_complex_t z) {
+    if (RealD)
+      RealD[r * vsources + c] = real(z);
+    else
+      MatrixD[r * vsources + c] = z;
+  }
+  /* Same as above with different argument type. */
+  void setD(int r, int c, double z) {
+    if (RealD)
+      RealD[r * vsources + c] = z;
+    else
+      MatrixD[r * vsources + c] = z;
+  }
   /* Sets the circuits C-HB matrix value depending on the port numbers. */
   void setQV(int r, int c, nr_complex_t qv) { MatrixQV[r * size + c] = qv; }
   /* Sets the circuits GV-HB matrix value depending on the port number. */
@@ -293,23 +377,81 @@ public:
   /* Sets the circuits CV-HB matrix value depending on the port number. */
   void setCV(int port, nr_complex_t cv) { VectorCV[port] = cv; }
   /* Sets the circuits E-MNA matrix value of the given voltage source built in the circuit. */
-  void setE(int nr, nr_complex_t z) { VectorE[nr] = z; }
+  void setE(int nr, nr_complex_t z) {
+    if (RealE)
+      RealE[nr] = real(z);
+    else
+      VectorE[nr] = z;
+  }
+  /* Same as above with different argument type. */
+  void setE(int nr, double z) {
+    if (RealE)
+      RealE[nr] = z;
+    else
+      VectorE[nr] = z;
+  }
   /* Sets the circuits I-MNA matrix value of the current source built in the circuit depending on
    * the port number. */
-  void setI(int port, nr_complex_t z) { VectorI[port] = z; }
+  void setI(int port, nr_complex_t z) {
+    if (RealI)
+      RealI[port] = real(z);
+    else
+      VectorI[port] = z;
+  }
+  /* Same as above with different argument type. */
+  void setI(int port, double z) {
+    if (RealI)
+      RealI[port] = z;
+    else
+      VectorI[port] = z;
+  }
   /* Modifies the circuits I-MNA matrix value of the current source built in the circuit depending
    * on the port number. */
-  void addI(int port, nr_complex_t i) { VectorI[port] += i; }
+  void addI(int port, nr_complex_t i) {
+    if (RealI)
+      RealI[port] += real(i);
+    else
+      VectorI[port] += i;
+  }
   /* Same as above with different argument type. */
-  void addI(int port, double i) { VectorI[port] += i; }
+  void addI(int port, double i) {
+    if (RealI)
+      RealI[port] += i;
+    else
+      VectorI[port] += i;
+  }
   /* Sets the circuits J-MNA matrix value of the given voltage source built in the circuit. */
-  void setJ(int nr, nr_complex_t z) { VectorJ[nr - vsource] = z; }
+  void setJ(int nr, nr_complex_t z) {
+    if (RealJ)
+      RealJ[nr - vsource] = real(z);
+    else
+      VectorJ[nr - vsource] = z;
+  }
+  /* Same as above with different argument type. */
+  void setJ(int nr, double z) {
+    if (RealJ)
+      RealJ[nr - vsource] = z;
+    else
+      VectorJ[nr - vsource] = z;
+  }
   /* Sets the circuits voltage value at the given port. */
-  void setV(int port, nr_complex_t z) { VectorV[port] = z; }
+  void setV(int port, nr_complex_t z) {
+    if (RealV)
+      RealV[port] = real(z);
+    else
+      VectorV[port] = z;
+  }
+  /* Same as above with different argument type. */
+  void setV(int port, double z) {
+    if (RealV)
+      RealV[port] = z;
+    else
+      VectorV[port] = z;
+  }
   /* Sets the circuits Q-HB vector value. */
   void setQ(int port, nr_complex_t q) { VectorQ[port] = q; }
   /* Sets the circuits G-MNA matrix value depending on the port numbers. */
-  void setG(int r, int c, double y) { MatrixY[r * size + c] = y; }
+  void setG(int r, int c, double y) { setY(r, c, y); }
 
   void clearB();
   void clearC();
@@ -353,6 +495,11 @@ public:
   void allocMatrixN(int sources = 0);
   void allocMatrixMNA();
   void freeMatrixMNA();
+  /* Selects real-valued storage of the MNA matrices and vectors used by the
+   * DC and transient analyses.  Already allocated buffers are converted
+   * to the new type, keeping their values (the real parts). */
+  void setRealMNA(bool);
+  bool isRealMNA() const { return RETFLAG(CIRCUIT_REALMNA); }
   void allocMatrixHB();
   void freeMatrixHB();
   void setMatrixS(matrix);
@@ -394,6 +541,14 @@ private:
                           // voltages. Devices read this value. DC/TR analysis.
   nr_complex_t *VectorJ;  // ARA: The `nasolver` class updates this vector with the solved branch
                           // currents. Devices read this value. DC/TR analysis.
+  double *RealY; // The real-valued counterparts of the above MNA matrices and vectors,
+  double *RealB; // only one of both is allocated at the same time.
+  double *RealC;
+  double *RealD;
+  double *RealE;
+  double *RealI;
+  double *RealV;
+  double *RealJ;
   nr_complex_t *VectorQ;  // ARA: For HB analysis only.
   nr_complex_t *MatrixQV; // ARA: For HB analysis only.
   nr_complex_t *VectorGV; // ARA: For HB analysis only.
@@ -73,6 +73,20 @@ void digisource::calcTR (double t) {
   setE (VSRC_1, lo ? 0 : v);
 }
 
+/* The transitions of the periodic bit sequence. */
+double digisource::nextBreakpoint (double t) {
+  qucs::vector * values = getPropertyVector ("times");
+  double ti = T * qucs::floor (t / T);
+
+  for (int n = 0; n < 2; n++) {
+    for (int i = 0; i < values->getSize (); i++) {
+      ti += real (values->get (i));
+      if (ti > t) return ti;
+    }
+  }
+  return std::numeric_limits<double>::max ();
+}
+
 // properties
 PROP_REQ [] = {
   { "init", PROP_STR, { PROP_NO_VAL, "low" }, PROP_RNG_STR2 ("low", "high") },
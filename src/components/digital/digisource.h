@@ -30,6 +30,7 @@ public:
   void initAC() override;
   void initTR() override;
   void calcTR(double) override;
+  double nextBreakpoint(double) override;
 
 private:
   double T;
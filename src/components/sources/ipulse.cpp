@@ -80,6 +80,21 @@ void ipulse::calcTR (double t) {
   setI (NODE_1, +it * s); setI (NODE_2, -it * s);
 }
 
+/* The corners of the pulse. */
+double ipulse::nextBreakpoint (double t) {
+  double t1 = getPropertyDouble ("T1");
+  double t2 = getPropertyDouble ("T2");
+  double tr = getPropertyDouble ("Tr");
+  double tf = getPropertyDouble ("Tf");
+  double corner[4] = { t1, t1 + tr, t2 - tf, t2 };
+  double tb = std::numeric_limits<double>::max ();
+
+  for (int i = 0; i < 4; i++) {
+    if (corner[i] > t && corner[i] < tb) tb = corner[i];
+  }
+  return tb;
+}
+
 // properties
 PROP_REQ [] = {
   { "I1", PROP_REAL, { 0, PROP_NO_STR }, PROP_NO_RANGE },
@@ -31,6 +31,7 @@ class ipulse : public qucs::circuit
   void initAC (void);
   void initTR (void);
   void calcTR (double);
+  double nextBreakpoint (double);
 };
 
 #endif /* __IPULSE_H__ */
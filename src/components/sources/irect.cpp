@@ -88,6 +88,29 @@ void irect::calcTR (double t) {
   setI (NODE_1, +it * s); setI (NODE_2, -it * s);
 }
 
+/* The corners of the periodic pulse, the end of the delay first. */
+double irect::nextBreakpoint (double t) {
+  double th = getPropertyDouble ("TH");
+  double tl = getPropertyDouble ("TL");
+  double tr = getPropertyDouble ("Tr");
+  double tf = getPropertyDouble ("Tf");
+  double td = getPropertyDouble ("Td");
+
+  if (tr > th) tr = th;
+  if (tf > tl) tf = tl;
+
+  if (t < td) return td;
+  double tp = th + tl;
+  double t0 = td + tp * qucs::floor ((t - td) / tp);
+  double corner[4] = { tr, th, th + tf, tp };
+  for (int n = 0; n < 2; n++, t0 += tp) {
+    for (int i = 0; i < 4; i++) {
+      if (t0 + corner[i] > t) return t0 + corner[i];
+    }
+  }
+  return std::numeric_limits<double>::max ();
+}
+
 // properties
 PROP_REQ [] = {
   { "I", PROP_REAL, { 1e-3, PROP_NO_STR }, PROP_NO_RANGE },
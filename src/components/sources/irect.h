@@ -31,6 +31,7 @@ class irect : public qucs::circuit
   void initAC (void);
   void initTR (void);
   void calcTR (double);
+  double nextBreakpoint (double);
 };
 
 #endif /* __IRECT_H__ */
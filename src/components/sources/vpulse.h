@@ -31,6 +31,7 @@ class vpulse : public qucs::circuit
   void initAC (void);
   void initTR (void);
   void calcTR (double);
+  double nextBreakpoint (double);
 };
 
 #endif /* __VPULSE_H__ */
@@ -31,6 +31,7 @@ class vrect : public qucs::circuit
   void initAC (void);
   void initTR (void);
   void calcTR (double);
+  double nextBreakpoint (double);
 };
 
 #endif /* __VRECT_H__ */
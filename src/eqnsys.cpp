@@ -17,9 +17,19 @@
  * Boston, MA 02110-1301, USA.
  */
 
+#include <algorithm>
 #include <cassert>
 #include <cmath>
+#include <condition_variable>
+#include <functional>
 #include <limits>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
 
 #include "logging.h"
 #include "precision.h"
@@ -37,14 +47,24 @@ namespace qucs {
 template <class nr_type_t>
 eqnsys<nr_type_t>::eqnsys () {
   A = V = NULL;
+  As = NULL;
   B = X = NULL;
   S = E = NULL;
   T = R = NULL;
   nPvt = NULL;
   cMap = rMap = NULL;
   update = 1;
+  reuse = 0;
+  threads = 1;
+  iterations = 0;
+  residual = 0;
   pivoting = PIVOT_PARTIAL;
   N = 0;
+  Kmul = Kpre = NULL;
+  Kdata = NULL;
+  Ktol = 1e-12;
+  KmaxIter = 0;
+  fallback = 0;
 }
 
 template <class nr_type_t>
@@ -60,6 +80,17 @@ eqnsys<nr_type_t>::~eqnsys () {
   delete[] nPvt;
 }
 
+/* Sets the size of the equation system and (re-)allocates the row
+   and column maps and the pivot scale factors accordingly. */
+template <class nr_type_t>
+void eqnsys<nr_type_t>::resize (int n) {
+  if (N == n) return;
+  N = n;
+  delete[] cMap; cMap = new int[N];
+  delete[] rMap; rMap = new int[N];
+  delete[] nPvt; nPvt = new double[N];
+}
+
 /*! With this function the describing matrices for the equation system
    is passed to the equation system solver class.  Matrix A is the
    left hand side of the equation system and B the right hand side
@@ -71,13 +102,31 @@ void eqnsys<nr_type_t>::passEquationSys (tmatrix<nr_type_t> * nA,
 					 tvector<nr_type_t> * nB) {
   if (nA != NULL) {
     A = nA;
+    As = NULL;
+    Kmul = Kpre = NULL;
     update = 1;
-    if (N != A->getCols ()) {
-      N = A->getCols ();
-      delete[] cMap; cMap = new int[N];
-      delete[] rMap; rMap = new int[N];
-      delete[] nPvt; nPvt = new double[N];
-    }
+    resize (A->getCols ());
+  }
+  else {
+    update = 0;
+  }
+  delete B;
+  B = new tvector<nr_type_t> (*nB);
+  X = refX;
+}
+
+/*! This is the sparse matrix variant of the above function.  The
+   structure of the given matrix must have been compress()'ed. */
+template <class nr_type_t>
+void eqnsys<nr_type_t>::passEquationSys (tspmatrix<nr_type_t> * nA,
+					 tvector<nr_type_t> * refX,
+					 tvector<nr_type_t> * nB) {
+  if (nA != NULL) {
+    As = nA;
+    A = NULL;
+    Kmul = Kpre = NULL;
+    update = 1;
+    resize (As->getCols ());
   }
   else {
     update = 0;
@@ -87,6 +136,29 @@ void eqnsys<nr_type_t>::passEquationSys (tmatrix<nr_type_t> * nA,
   X = refX;
 }
 
+/*! This variant passes an equation system which is not available as
+   matrix but only as operator computing the matrix-vector product,
+   e.g. a Jacobian assembled on the fly.  It can be solved by the
+   Krylov subspace methods only.  The optional preconditioner
+   operator applies an approximate inverse of the matrix, the data
+   pointer is handed to both operators. */
+template <class nr_type_t>
+void eqnsys<nr_type_t>::passEquationSys (operator_func_t mul,
+					 operator_func_t pre, void * data,
+					 tvector<nr_type_t> * refX,
+					 tvector<nr_type_t> * nB) {
+  A = NULL;
+  As = NULL;
+  Kmul = mul;
+  Kpre = pre;
+  Kdata = data;
+  update = 0;
+  resize (nB->size ());
+  delete B;
+  B = new tvector<nr_type_t> (*nB);
+  X = refX;
+}
+
 /*! Depending on the algorithm applied to the equation system solver
    the function stores the solution of the system into the matrix
    pointed to by the X matrix reference. */
@@ -123,12 +195,30 @@ void eqnsys<nr_type_t>::solve (void) {
   case ALGO_LU_SUBSTITUTION_DOOLITTLE:
     substitute_lu_doolittle ();
     break;
+  case ALGO_LU_DECOMPOSITION_BLOCKED:
+    solve_lu_blocked ();
+    break;
+  case ALGO_LU_FACTORIZATION_BLOCKED:
+    factorize_lu_blocked ();
+    break;
+  case ALGO_LU_DECOMPOSITION_MIXED:
+    solve_lu_mixed ();
+    break;
+  case ALGO_LU_FACTORIZATION_MIXED:
+    factorize_lu_mixed ();
+    break;
+  case ALGO_LU_SUBSTITUTION_MIXED:
+    substitute_lu_mixed ();
+    break;
   case ALGO_JACOBI: case ALGO_GAUSS_SEIDEL:
     solve_iterative ();
     break;
   case ALGO_SOR:
     solve_sor ();
     break;
+  case ALGO_GMRES: case ALGO_BICGSTAB:
+    solve_krylov ();
+    break;
   case ALGO_QR_DECOMPOSITION:
     solve_qr ();
     break;
@@ -141,6 +231,15 @@ void eqnsys<nr_type_t>::solve (void) {
   case ALGO_QR_DECOMPOSITION_2:
     solve_qrh ();
     break;
+  case ALGO_LU_DECOMPOSITION_SPARSE:
+    solve_lu_sparse ();
+    break;
+  case ALGO_LU_FACTORIZATION_SPARSE:
+    factorize_lu_sparse ();
+    break;
+  case ALGO_LU_SUBSTITUTION_SPARSE:
+    substitute_lu_sparse ();
+    break;
   }
 #if DEBUG && 0
   logprint (LOG_STATUS, "NOTIFY: %dx%d eqnsys solved in %ld seconds\n",
@@ -249,6 +348,250 @@ void eqnsys<nr_type_t>::solve_gauss_jordan (void) {
   A_(i, i) = NR_TINY; /* virtual resistance to ground */	  \
   throw_exception (e); }
 
+/* Inner update kernels of the blocked LU decomposition.  The first
+   one computes y[0..n) -= a * x[0..n) on contiguous matrix rows, the
+   second one y[0..n) -= l[0] * u[0..n) + ... + l[m-1] * u[(m-1)*ld..),
+   i.e. a row of the trailing matrix update, keeping y in registers. */
+#ifdef __AVX2__
+static inline __m256d lu_fnmadd (__m256d a, __m256d x, __m256d y) {
+#ifdef __FMA__
+  return _mm256_fnmadd_pd (a, x, y);
+#else
+  return _mm256_sub_pd (y, _mm256_mul_pd (a, x));
+#endif
+}
+
+// complex products of (real, imag) pairs, two per register
+static inline __m256d lu_cmul (__m256d ar, __m256d ai, __m256d x) {
+  __m256d xs = _mm256_permute_pd (x, 0x5); // (imag, real) pairs
+  return _mm256_addsub_pd (_mm256_mul_pd (ar, x), _mm256_mul_pd (ai, xs));
+}
+#endif
+
+static inline void lu_axpy (double * y, const double * x, double a, int n) {
+  int i = 0;
+#ifdef __AVX2__
+  __m256d va = _mm256_set1_pd (a);
+  for (; i + 4 <= n; i += 4)
+    _mm256_storeu_pd (y + i, lu_fnmadd (va, _mm256_loadu_pd (x + i),
+					_mm256_loadu_pd (y + i)));
+#endif
+  for (; i < n; i++) y[i] -= a * x[i];
+}
+
+static inline void lu_axpy (nr_complex_t * y, const nr_complex_t * x,
+			    nr_complex_t a, int n) {
+  int i = 0;
+#ifdef __AVX2__
+  double * py = reinterpret_cast<double *> (y);
+  const double * px = reinterpret_cast<const double *> (x);
+  __m256d ar = _mm256_set1_pd (real (a));
+  __m256d ai = _mm256_set1_pd (imag (a));
+  for (; i + 2 <= n; i += 2) {
+    __m256d vp = lu_cmul (ar, ai, _mm256_loadu_pd (px + 2 * i));
+    _mm256_storeu_pd (py + 2 * i,
+		      _mm256_sub_pd (_mm256_loadu_pd (py + 2 * i), vp));
+  }
+#endif
+  for (; i < n; i++) y[i] -= a * x[i];
+}
+
+static inline void lu_gemv (double * y, const double * l, const double * u,
+			    int ld, int m, int n) {
+  int i = 0, j;
+#ifdef __AVX2__
+  for (; i + 16 <= n; i += 16) {
+    __m256d y0 = _mm256_loadu_pd (y + i +  0);
+    __m256d y1 = _mm256_loadu_pd (y + i +  4);
+    __m256d y2 = _mm256_loadu_pd (y + i +  8);
+    __m256d y3 = _mm256_loadu_pd (y + i + 12);
+    for (j = 0; j < m; j++) {
+      const double * x = u + j * ld + i;
+      __m256d va = _mm256_set1_pd (l[j]);
+      y0 = lu_fnmadd (va, _mm256_loadu_pd (x +  0), y0);
+      y1 = lu_fnmadd (va, _mm256_loadu_pd (x +  4), y1);
+      y2 = lu_fnmadd (va, _mm256_loadu_pd (x +  8), y2);
+      y3 = lu_fnmadd (va, _mm256_loadu_pd (x + 12), y3);
+    }
+    _mm256_storeu_pd (y + i +  0, y0);
+    _mm256_storeu_pd (y + i +  4, y1);
+    _mm256_storeu_pd (y + i +  8, y2);
+    _mm256_storeu_pd (y + i + 12, y3);
+  }
+#endif
+  for (j = 0; j < m; j++) lu_axpy (y + i, u + j * ld + i, l[j], n - i);
+}
+
+static inline void lu_gemv (nr_complex_t * y, const nr_complex_t * l,
+			    const nr_complex_t * u, int ld, int m, int n) {
+  int i = 0, j;
+#ifdef __AVX2__
+  double * py = reinterpret_cast<double *> (y);
+  const double * pu = reinterpret_cast<const double *> (u);
+  for (; i + 8 <= n; i += 8) {
+    __m256d y0 = _mm256_loadu_pd (py + 2 * i +  0);
+    __m256d y1 = _mm256_loadu_pd (py + 2 * i +  4);
+    __m256d y2 = _mm256_loadu_pd (py + 2 * i +  8);
+    __m256d y3 = _mm256_loadu_pd (py + 2 * i + 12);
+    for (j = 0; j < m; j++) {
+      const double * x = pu + 2 * (j * ld + i);
+      __m256d ar = _mm256_set1_pd (real (l[j]));
+      __m256d ai = _mm256_set1_pd (imag (l[j]));
+      y0 = _mm256_sub_pd (y0, lu_cmul (ar, ai, _mm256_loadu_pd (x +  0)));
+      y1 = _mm256_sub_pd (y1, lu_cmul (ar, ai, _mm256_loadu_pd (x +  4)));
+      y2 = _mm256_sub_pd (y2, lu_cmul (ar, ai, _mm256_loadu_pd (x +  8)));
+      y3 = _mm256_sub_pd (y3, lu_cmul (ar, ai, _mm256_loadu_pd (x + 12)));
+    }
+    _mm256_storeu_pd (py + 2 * i +  0, y0);
+    _mm256_storeu_pd (py + 2 * i +  4, y1);
+    _mm256_storeu_pd (py + 2 * i +  8, y2);
+    _mm256_storeu_pd (py + 2 * i + 12, y3);
+  }
+#endif
+  for (j = 0; j < m; j++) lu_axpy (y + i, u + j * ld + i, l[j], n - i);
+}
+
+/* The same row update for the single precision factors of the mixed
+   precision LU decomposition.  A register holds twice as many values
+   as in double precision. */
+static inline void lu_axpy (float * y, const float * x, float a, int n) {
+  int i = 0;
+#ifdef __AVX2__
+  __m256 va = _mm256_set1_ps (a);
+  for (; i + 8 <= n; i += 8)
+    _mm256_storeu_ps (y + i, _mm256_sub_ps (_mm256_loadu_ps (y + i),
+					    _mm256_mul_ps (va, _mm256_loadu_ps (x + i))));
+#endif
+  for (; i < n; i++) y[i] -= a * x[i];
+}
+
+static inline void lu_axpy (std::complex<float> * y,
+			    const std::complex<float> * x,
+			    std::complex<float> a, int n) {
+  int i = 0;
+  float * py = reinterpret_cast<float *> (y);
+  const float * px = reinterpret_cast<const float *> (x);
+  const float ar = real (a), ai = imag (a);
+#ifdef __AVX2__
+  __m256 var = _mm256_set1_ps (ar);
+  __m256 vai = _mm256_set1_ps (ai);
+  for (; i + 4 <= n; i += 4) {
+    __m256 vx = _mm256_loadu_ps (px + 2 * i);
+    __m256 vs = _mm256_permute_ps (vx, 0xb1); // (imag, real) pairs
+    __m256 vp = _mm256_addsub_ps (_mm256_mul_ps (var, vx),
+				  _mm256_mul_ps (vai, vs));
+    _mm256_storeu_ps (py + 2 * i,
+		      _mm256_sub_ps (_mm256_loadu_ps (py + 2 * i), vp));
+  }
+#endif
+  for (; i < n; i++) {
+    float xr = px[2 * i], xi = px[2 * i + 1];
+    py[2 * i] -= ar * xr - ai * xi;
+    py[2 * i + 1] -= ar * xi + ai * xr;
+  }
+}
+
+/* Runs the given function for the ranges of an equal partition of
+   [0..n) on at most the given number of threads, each range spanning
+   at least 'grain' elements.  The calling thread takes the first
+   range itself. */
+template <class func_t>
+static void lu_parallel (int threads, int n, int grain, func_t func) {
+  int i, t = std::min (threads, n / std::max (grain, 1));
+  if (t <= 1) {
+    func (0, n);
+    return;
+  }
+  std::vector<std::thread> workers;
+  for (i = 1; i < t; i++)
+    workers.emplace_back (func, (int) ((long) i * n / t),
+			  (int) ((long) (i + 1) * n / t));
+  func (0, n / t);
+  for (auto & w : workers) w.join ();
+}
+
+/* A team of worker threads kept for the duration of a factorization.
+   Each call of run() partitions [0..n) like lu_parallel() does, the
+   calling thread takes the first range and the workers the others,
+   and returns once all ranges have been processed. */
+class lu_team {
+public:
+  lu_team (int threads) {
+    count = std::max (threads, 1);
+    active = pending = 0;
+    generation = 0;
+    size = 0;
+    task = NULL;
+    quit = false;
+    for (int i = 1; i < count; i++)
+      workers.emplace_back (&lu_team::work, this, i);
+  }
+
+  ~lu_team () {
+    {
+      std::lock_guard<std::mutex> lock (mutex);
+      quit = true;
+      generation++;
+    }
+    start.notify_all ();
+    for (auto & w : workers) w.join ();
+  }
+
+  void run (int n, int grain, const std::function<void (int, int)> & func) {
+    int t = std::min (count, n / std::max (grain, 1));
+    if (t <= 1) {
+      func (0, n);
+      return;
+    }
+    {
+      std::lock_guard<std::mutex> lock (mutex);
+      task = &func;
+      size = n;
+      active = t;
+      pending = t - 1;
+      generation++;
+    }
+    start.notify_all ();
+    func (0, n / t);
+    std::unique_lock<std::mutex> lock (mutex);
+    done.wait (lock, [this] { return pending == 0; });
+  }
+
+private:
+  void work (int i) {
+    unsigned long seen = 0;
+    for (;;) {
+      const std::function<void (int, int)> * func;
+      int n, t;
+      {
+	std::unique_lock<std::mutex> lock (mutex);
+	start.wait (lock, [&] { return generation != seen; });
+	seen = generation;
+	if (quit) return;
+	if (i >= active) continue;
+	func = task;
+	n = size;
+	t = active;
+      }
+      (*func) ((int) ((long) i * n / t), (int) ((long) (i + 1) * n / t));
+      std::lock_guard<std::mutex> lock (mutex);
+      if (--pending == 0) done.notify_one ();
+    }
+  }
+
+  int count, active, pending, size;
+  unsigned long generation;
+  const std::function<void (int, int)> * task;
+  bool quit;
+  std::mutex mutex;
+  std::condition_variable start, done;
+  std::vector<std::thread> workers;
+};
+
+#define LU_PANEL 32  // panel width of the blocked LU decomposition
+#define LU_TILE  256 // column tile width of the trailing matrix update
+#define LU_REFINE 10  // maximum number of iterative refinement steps
+
 /*! The function uses LU decomposition and the appropriate forward and
    backward substitutions in order to solve the linear equation
    system.  It is very useful when dealing with equation systems where
@@ -424,6 +767,15 @@ void eqnsys<nr_type_t>::factorize_lu_doolittle (void) {
    Uii are ones).  */
 template <class nr_type_t>
 void eqnsys<nr_type_t>::substitute_lu_crout (void) {
+  substitute_lu_crout (X, B);
+}
+
+/*! This is the above substitution for the given solution and right
+   hand side vectors instead of the ones passed to the equation
+   system. */
+template <class nr_type_t>
+void eqnsys<nr_type_t>::substitute_lu_crout (tvector<nr_type_t> * X,
+					     tvector<nr_type_t> * B) {
   nr_type_t f;
   int i, c;
 
@@ -449,6 +801,15 @@ void eqnsys<nr_type_t>::substitute_lu_crout (void) {
    transposed LU matrices as used in the AC noise analysis. */
 template <class nr_type_t>
 void eqnsys<nr_type_t>::substitute_lu_doolittle (void) {
+  substitute_lu_doolittle (X, B);
+}
+
+/*! This is the above substitution for the given solution and right
+   hand side vectors instead of the ones passed to the equation
+   system. */
+template <class nr_type_t>
+void eqnsys<nr_type_t>::substitute_lu_doolittle (tvector<nr_type_t> * X,
+						 tvector<nr_type_t> * B) {
   nr_type_t f;
   int i, c;
 
@@ -468,6 +829,575 @@ void eqnsys<nr_type_t>::substitute_lu_doolittle (void) {
   }
 }
 
+/*! The function solves the equation system using the blocked LU
+   decomposition.  The decomposition is stored just like Doolittle's,
+   thus the same substitutions apply. */
+template <class nr_type_t>
+void eqnsys<nr_type_t>::solve_lu_blocked (void) {
+
+  // skip decomposition if requested
+  if (update) {
+    // perform LU composition
+    factorize_lu_blocked ();
+  }
+
+  // finally solve the equation system
+  substitute_lu_doolittle ();
+}
+
+/*! This function decomposes the left hand matrix into a lower L
+   matrix with unit diagonal and an upper U matrix (Doolittle's
+   definition) using a blocked right-looking algorithm.  A panel of
+   columns is factorized with (implicit) partial row pivoting first,
+   then the corresponding block row of U is computed and finally the
+   trailing matrix is updated.  The latter two steps are independent
+   for different columns, thus they are split into column ranges
+   which run on a team of threads if requested. */
+template <class nr_type_t>
+void eqnsys<nr_type_t>::factorize_lu_blocked (void) {
+  double d, MaxPivot;
+  nr_type_t f;
+  int c, r, k, kb, pivot;
+  nr_type_t * a = A->getData ();
+
+  // initialize pivot exchange table
+  for (r = 0; r < N; r++) {
+    for (MaxPivot = 0, c = 0; c < N; c++)
+      if ((d = abs (A_(r, c))) > MaxPivot)
+	MaxPivot = d;
+    if (MaxPivot <= 0) MaxPivot = NR_TINY;
+    nPvt[r] = 1 / MaxPivot;
+    rMap[r] = r;
+  }
+
+  // the threads updating the trailing matrix, started once
+  lu_team team (std::min (threads, N / LU_PANEL));
+
+  for (k = 0; k < N; k += LU_PANEL) {
+    kb = std::min (LU_PANEL, N - k);
+
+    // factorize the panel A(k:N, k:k+kb)
+    for (c = k; c < k + kb; c++) {
+      for (MaxPivot = 0, pivot = c, r = c; r < N; r++) {
+	// larger pivot ?
+	if ((d = nPvt[r] * abs (a[r * N + c])) > MaxPivot) {
+	  MaxPivot = d;
+	  pivot = r;
+	}
+      }
+
+      // check pivot element and throw appropriate exception
+      if (MaxPivot <= 0) {
+	VIRTUAL_RES ("no pivot != 0 found during blocked LU decomposition", c);
+      }
+
+      // swap matrix rows if necessary and remember that step in the
+      // exchange table
+      if (c != pivot) {
+	std::swap_ranges (&a[c * N], &a[c * N + N], &a[pivot * N]);
+	SWAP (int, rMap[c], rMap[pivot]);
+	SWAP (double, nPvt[c], nPvt[pivot]);
+      }
+
+      // lower matrix entries and update of the remaining panel columns
+      for (r = c + 1; r < N; r++) {
+	f = a[r * N + c] /= a[c * N + c];
+	lu_axpy (&a[r * N + c + 1], &a[c * N + c + 1], f, k + kb - c - 1);
+      }
+    }
+
+    // block row of U and trailing matrix right of the panel
+    team.run (N - k - kb, LU_PANEL, [&] (int c0, int c1) {
+	update_lu_blocked (k, kb, k + kb + c0, k + kb + c1);
+      });
+  }
+}
+
+/*! Helper function for the blocked LU decomposition.  Once the panel
+   of columns k..k+kb has been factorized it computes the upper matrix
+   entries U12 = L11^-1 * A12 and updates the trailing matrix
+   A22 -= L21 * U12 for the columns c0..c1 right of that panel.  All
+   updates run along contiguous rows of the matrix, column tiles keep
+   the rows of U in the cache. */
+template <class nr_type_t>
+void eqnsys<nr_type_t>::update_lu_blocked (int k, int kb, int c0, int c1) {
+  int i, j, r, cb, cw;
+  nr_type_t * a = A->getData ();
+
+  // upper matrix entries, forward substitution with L11
+  for (i = k + 1; i < k + kb; i++) {
+    for (j = k; j < i; j++)
+      lu_axpy (&a[i * N + c0], &a[j * N + c0], a[i * N + j], c1 - c0);
+  }
+
+  // update of the trailing matrix
+  for (cb = c0; cb < c1; cb += LU_TILE) {
+    cw = std::min (LU_TILE, c1 - cb);
+    for (r = k + kb; r < N; r++)
+      lu_gemv (&a[r * N + cb], &a[r * N + k], &a[k * N + cb], N, kb, cw);
+  }
+}
+
+/*! The function computes the inverse of the left hand side matrix
+   passed to the equation system and stores it into the given matrix.
+   It expects the matrix to be LU decomposed already (a factorization
+   algorithm must have been run) and the algorithm to be set to the
+   matching substitution.  The unit vectors are substituted column by
+   column, on separate threads if requested. */
+template <class nr_type_t>
+void eqnsys<nr_type_t>::invert (tmatrix<nr_type_t> * H) {
+  lu_parallel (threads, N, 16, [&] (int c0, int c1) {
+      tvector<nr_type_t> x (N), b (N);
+      for (int c = c0; c < c1; c++) {
+	b.set (0.0);
+	b.set (c, 1.0);
+	if (algo == ALGO_LU_SUBSTITUTION_CROUT)
+	  substitute_lu_crout (&x, &b);
+	else
+	  substitute_lu_doolittle (&x, &b);
+	for (int r = 0; r < N; r++) H->set (r, c, x.get (r));
+      }
+    });
+}
+
+/*! The function solves the equation system using an LU decomposition
+   computed in single precision.  The double precision accuracy of the
+   solution is recovered by iterative refinement against the original
+   matrix, which is therefore left untouched.  Just like the other LU
+   variants the decomposition is skipped if the matrix has not been
+   changed. */
+template <class nr_type_t>
+void eqnsys<nr_type_t>::solve_lu_mixed (void) {
+
+  // skip decomposition if requested
+  if (update) {
+    // perform LU composition
+    factorize_lu_mixed ();
+  }
+
+  // finally solve the equation system
+  substitute_lu_mixed ();
+}
+
+/*! This function decomposes a single precision copy of the left hand
+   matrix into a lower L matrix with unit diagonal and an upper U
+   matrix (Doolittle's definition) using (implicit) partial row
+   pivoting.  The row updates run along contiguous rows.  If no pivot
+   can be found in single precision the matrix is decomposed in double
+   precision instead. */
+template <class nr_type_t>
+void eqnsys<nr_type_t>::factorize_lu_mixed (void) {
+  typedef typename eqnsys_single<nr_type_t>::type single_t;
+  double d, MaxPivot;
+  single_t f;
+  int c, r, pivot;
+  nr_type_t * a = A->getData ();
+
+  // initialize pivot exchange table and the single precision matrix
+  Fx.resize ((size_t) N * N);
+  single_t * u = Fx.data ();
+  for (r = 0; r < N; r++) {
+    for (MaxPivot = 0, c = 0; c < N; c++) {
+      u[r * N + c] = (single_t) a[r * N + c];
+      if ((d = abs (a[r * N + c])) > MaxPivot)
+	MaxPivot = d;
+    }
+    if (MaxPivot <= 0) MaxPivot = NR_TINY;
+    nPvt[r] = 1 / MaxPivot;
+    rMap[r] = r;
+  }
+  fallback = 0;
+
+  for (c = 0; c < N; c++) {
+    for (MaxPivot = 0, pivot = c, r = c; r < N; r++) {
+      // larger pivot ?
+      if ((d = nPvt[r] * std::abs (u[r * N + c])) > MaxPivot) {
+	MaxPivot = d;
+	pivot = r;
+      }
+    }
+
+    // singular or out of range in single precision, use double precision
+    if (MaxPivot <= 0 || !std::isfinite (MaxPivot)) {
+      logprint (LOG_STATUS, "NOTIFY: no pivot found during single precision "
+		"LU decomposition, using double precision\n");
+      fallback = 1;
+      factorize_lu_doolittle ();
+      return;
+    }
+
+    // swap matrix rows if necessary and remember that step in the
+    // exchange table
+    if (c != pivot) {
+      std::swap_ranges (&u[c * N], &u[c * N + N], &u[pivot * N]);
+      SWAP (int, rMap[c], rMap[pivot]);
+      SWAP (double, nPvt[c], nPvt[pivot]);
+    }
+
+    // lower matrix entries and update of the remaining matrix
+    for (r = c + 1; r < N; r++) {
+      f = u[r * N + c] /= u[c * N + c];
+      if (f != (single_t) 0)
+	lu_axpy (&u[r * N + c + 1], &u[c * N + c + 1], f, N - c - 1);
+    }
+  }
+}
+
+/*! The function runs the iterative refinement using the single
+   precision LU factors.  Should the refinement stall the matrix is
+   decomposed in double precision, and all further substitutions use
+   these factors. */
+template <class nr_type_t>
+void eqnsys<nr_type_t>::substitute_lu_mixed (void) {
+  if (!fallback) {
+    if (refine_lu_mixed ())
+      return;
+    logprint (LOG_STATUS, "NOTIFY: iterative refinement stalled after %d "
+	      "steps (residual %g), using double precision LU decomposition\n",
+	      iterations, residual);
+    fallback = 1;
+    factorize_lu_doolittle ();
+  }
+  substitute_lu_doolittle ();
+}
+
+/*! Iterative refinement of the solution.  Each step solves
+   L * U * d = r with the single precision factors for the residual
+   r = B - A * X computed in double precision and updates X += d.  The
+   function returns non-zero once the normwise backward error
+   |r| / (|A| * |X| + |B|) has reached the double precision rounding
+   level, and zero if the residual does not at least halve in a
+   step. */
+template <class nr_type_t>
+int eqnsys<nr_type_t>::refine_lu_mixed (void) {
+  const double eps = std::numeric_limits<double>::epsilon () * std::sqrt ((double) N);
+  const nr_type_t * a = A->getData ();
+  const auto * u = Fx.data ();
+  double nA = 0, nB = 0, nX, nR, nRprev, s;
+  nr_type_t f;
+  int i, c, it;
+
+  tvector<nr_type_t> rv (*B), dv (N);
+  nr_type_t * r = rv.getData (), * d = dv.getData ();
+  nr_type_t * b = B->getData (), * x = X->getData ();
+
+  // norms of the matrix and the right hand side
+  for (i = 0; i < N; i++) {
+    for (s = 0, c = 0; c < N; c++) s += abs (a[i * N + c]);
+    nA = MAX (nA, s);
+    nB = MAX (nB, abs (b[i]));
+  }
+  nRprev = nB;
+  X->set (0.0);
+  residual = 0;
+  iterations = 0;
+  if (nB <= 0)
+    return 1;
+
+  for (it = 1; it <= LU_REFINE; it++) {
+    // forward substitution in order to solve LY = R
+    for (i = 0; i < N; i++) {
+      f = r[rMap[i]];
+      for (c = 0; c < i; c++) f -= (nr_type_t) u[i * N + c] * d[c];
+      d[i] = f;
+    }
+    // backward substitution in order to solve UD = Y
+    for (i = N - 1; i >= 0; i--) {
+      f = d[i];
+      for (c = i + 1; c < N; c++) f -= (nr_type_t) u[i * N + c] * d[c];
+      d[i] = f / (nr_type_t) u[i * N + i];
+    }
+
+    // update the solution and compute the new residual
+    for (nX = 0, i = 0; i < N; i++) {
+      x[i] += d[i];
+      nX = MAX (nX, abs (x[i]));
+    }
+    for (nR = 0, i = 0; i < N; i++) {
+      f = b[i];
+      for (c = 0; c < N; c++) f -= a[i * N + c] * x[c];
+      r[i] = f;
+      nR = MAX (nR, abs (f));
+    }
+    iterations = it;
+    residual = nR / (nA * nX + nB);
+    if (residual <= eps)
+      return 1;
+    if (!(nR < 0.5 * nRprev))
+      return 0;
+    nRprev = nR;
+  }
+  return 0;
+}
+
+/*! The function solves the sparse equation system using a sparse LU
+   decomposition.  Just like the dense variants the decomposition is
+   skipped if the left hand side matrix has not been changed. */
+template <class nr_type_t>
+void eqnsys<nr_type_t>::solve_lu_sparse (void) {
+
+  // skip decomposition if requested
+  if (update) {
+    // perform LU composition
+    factorize_lu_sparse ();
+  }
+
+  // finally solve the equation system
+  substitute_lu_sparse ();
+}
+
+/*! Helper function for the sparse LU decomposition.  It performs a
+   non-recursive depth-first search in the graph of the L matrix
+   computed so far starting at row 'j'.  All reached rows are pushed
+   onto the 'xi' stack in topological order and the new top of that
+   stack is returned.  Rows already visited are flagged with the given
+   mark. */
+template <class nr_type_t>
+int eqnsys<nr_type_t>::reach_sparse (int j, int top, int * xi, int * stack,
+				     int * pstack, int * flag, int mark) {
+  int i, p, p2, jnew, head = 0, done;
+  stack[0] = j;
+  while (head >= 0) {
+    j = stack[head];
+    jnew = pinv[j];
+    if (flag[j] != mark) {
+      // first visit of this row
+      flag[j] = mark;
+      pstack[head] = (jnew < 0) ? 0 : Lp[jnew];
+    }
+    done = 1;
+    p2 = (jnew < 0) ? 0 : Lp[jnew + 1];
+    for (p = pstack[head]; p < p2; p++) {
+      i = Li[p];
+      if (flag[i] == mark) continue;
+      // pause the search of row j and descend into row i
+      pstack[head] = p;
+      stack[++head] = i;
+      done = 0;
+      break;
+    }
+    if (done) {
+      // all rows reachable from j are done, push j onto output stack
+      head--;
+      xi[--top] = j;
+    }
+  }
+  return top;
+}
+
+/*! This function decomposes the sparse left hand matrix into a lower
+   L matrix with unit diagonal and an upper U matrix.  It is a left
+   looking (Gilbert-Peierls) algorithm computing one column after the
+   other by a sparse triangular solve.  Partial row pivoting is
+   applied but the diagonal element is preferred as long as it is not
+   too small compared to the largest pivot candidate.  If reuse is
+   enabled and the structure of the matrix did not change since the
+   last decomposition, a numeric-only refactorization keeping the
+   previous row permutation is tried first. */
+template <class nr_type_t>
+void eqnsys<nr_type_t>::factorize_lu_sparse (void) {
+  int * Ap = As->getColPtr ();
+  int * Ai = As->getRowIdx ();
+  nr_type_t * Ax = As->getData ();
+  double d, MaxPivot, tol = 1e-3;
+  nr_type_t f, pivot;
+  int i, j, k, p, px, top, ipiv, J;
+
+  // try to reuse the pivot order and the structure of the factors
+  if (reuse && refactorize_lu_sparse ()) return;
+
+  // workspace
+  std::vector<nr_type_t> x (N, 0);
+  std::vector<int> xi (N), stack (N), pstack (N), flag (N, -1);
+
+  // initialize the factors, the size of A is a good first guess
+  pinv.assign (N, -1);
+  Lp.assign (N + 1, 0); Li.clear (); Lx.clear ();
+  Up.assign (N + 1, 0); Ui.clear (); Ux.clear ();
+  Li.reserve (As->getNonZeros () + N); Lx.reserve (As->getNonZeros () + N);
+  Ui.reserve (As->getNonZeros () + N); Ux.reserve (As->getNonZeros () + N);
+
+  for (k = 0; k < N; k++) {
+    // find the non-zero pattern of x = L \ A(:,k)
+    for (top = N, p = Ap[k]; p < Ap[k + 1]; p++) {
+      if (flag[Ai[p]] != k)
+	top = reach_sparse (Ai[p], top, xi.data (), stack.data (),
+			    pstack.data (), flag.data (), k);
+    }
+    // scatter A(:,k) into the dense work vector
+    for (p = top; p < N; p++) x[xi[p]] = 0;
+    for (p = Ap[k]; p < Ap[k + 1]; p++) x[Ai[p]] += Ax[p];
+
+    // sparse forward substitution in topological order
+    for (px = top; px < N; px++) {
+      j = xi[px];
+      if ((J = pinv[j]) < 0) continue;
+      f = x[j];
+      for (p = Lp[J] + 1; p < Lp[J + 1]; p++) x[Li[p]] -= Lx[p] * f;
+    }
+
+    // upper matrix entries and search for the largest pivot candidate
+    for (MaxPivot = -1, ipiv = -1, px = top; px < N; px++) {
+      i = xi[px];
+      if (pinv[i] < 0) {
+	if ((d = abs (x[i])) > MaxPivot) {
+	  MaxPivot = d;
+	  ipiv = i;
+	}
+      }
+      else {
+	Ui.push_back (pinv[i]);
+	Ux.push_back (x[i]);
+      }
+    }
+
+    // check pivot element and throw appropriate exception
+    if (ipiv < 0 || MaxPivot <= 0) {
+      qucs::exception * e = new qucs::exception (EXCEPTION_SINGULAR);
+      e->setText ("no pivot != 0 found during sparse LU decomposition");
+      e->setData (k);
+      throw_exception (e);
+      // insert virtual resistance to ground
+      if (pinv[k] < 0) ipiv = k;
+      else for (ipiv = 0; pinv[ipiv] >= 0; ipiv++) ;
+      if (flag[ipiv] != k) {
+	flag[ipiv] = k;
+	xi[--top] = ipiv;
+      }
+      x[ipiv] = NR_TINY;
+    }
+    // prefer the diagonal element if large enough
+    else if (pinv[k] < 0 && flag[k] == k && abs (x[k]) >= tol * MaxPivot) {
+      ipiv = k;
+    }
+
+    // store the pivot as last entry of the U column and remember the
+    // row exchange
+    pivot = x[ipiv];
+    Ui.push_back (k);
+    Ux.push_back (pivot);
+    pinv[ipiv] = k;
+
+    // lower matrix entries, the unit diagonal comes first
+    Li.push_back (ipiv);
+    Lx.push_back (1);
+    for (px = top; px < N; px++) {
+      i = xi[px];
+      if (pinv[i] < 0) {
+	Li.push_back (i);
+	Lx.push_back (x[i] / pivot);
+      }
+      x[i] = 0;
+    }
+    Lp[k + 1] = Li.size ();
+    Up[k + 1] = Ui.size ();
+  }
+
+  // finally translate the row indices of L into pivoted row numbers
+  for (p = 0; p < (int) Li.size (); p++) Li[p] = pinv[Li[p]];
+
+  if (reuse) {
+    // sort the U columns, ascending row numbers are a valid topological
+    // order for later refactorizations (the pivot remains last)
+    std::vector<std::pair<int, nr_type_t> > col;
+    for (k = 0; k < N; k++) {
+      col.clear ();
+      for (p = Up[k]; p < Up[k + 1]; p++) col.push_back ({Ui[p], Ux[p]});
+      std::sort (col.begin (), col.end (),
+		 [] (const std::pair<int, nr_type_t> & a,
+		     const std::pair<int, nr_type_t> & b) {
+		   return a.first < b.first; });
+      for (p = Up[k]; p < Up[k + 1]; p++) {
+	Ui[p] = col[p - Up[k]].first;
+	Ux[p] = col[p - Up[k]].second;
+      }
+    }
+    // remember the structure of the decomposed matrix
+    Sp.assign (Ap, Ap + N + 1);
+    Si.assign (Ai, Ai + Ap[N]);
+  }
+}
+
+/*! This function recomputes the values of the sparse LU factors
+   keeping the row permutation and the structure of L and U found by
+   the last full decomposition.  This is possible as long as the
+   structure of the matrix did not change, e.g. during the Newton
+   iterations of a single analysis.  The function returns zero (and
+   the factors must be recomputed from scratch) if the structure is
+   different or a pivot became zero or too small compared to the
+   other entries of its column. */
+template <class nr_type_t>
+int eqnsys<nr_type_t>::refactorize_lu_sparse (void) {
+  int * Ap = As->getColPtr ();
+  int * Ai = As->getRowIdx ();
+  nr_type_t * Ax = As->getData ();
+  double MaxPivot, tol = 1e-3;
+  nr_type_t f, pivot;
+  int k, p, q, J;
+
+  // compare the structure of the matrix
+  if ((int) Sp.size () != N + 1 || (int) pinv.size () != N ||
+      !std::equal (Sp.begin (), Sp.end (), Ap) ||
+      (int) Si.size () != Ap[N] || !std::equal (Si.begin (), Si.end (), Ai))
+    return 0;
+
+  // the work vector is indexed by pivoted row numbers
+  std::vector<nr_type_t> x (N, 0);
+
+  for (k = 0; k < N; k++) {
+    // scatter A(:,k) into the work vector
+    for (p = Ap[k]; p < Ap[k + 1]; p++) x[pinv[Ai[p]]] += Ax[p];
+
+    // sparse forward substitution along the known U structure
+    for (p = Up[k]; p < Up[k + 1] - 1; p++) {
+      J = Ui[p];
+      Ux[p] = f = x[J];
+      x[J] = 0;
+      for (q = Lp[J] + 1; q < Lp[J + 1]; q++) x[Li[q]] -= Lx[q] * f;
+    }
+    pivot = x[k];
+    x[k] = 0;
+
+    // check the pivot against the remaining entries of the column
+    for (MaxPivot = 0, q = Lp[k] + 1; q < Lp[k + 1]; q++)
+      MaxPivot = MAX (MaxPivot, abs (x[Li[q]]));
+    if (pivot == 0.0 || abs (pivot) < tol * MaxPivot) return 0;
+
+    Ux[Up[k + 1] - 1] = pivot;
+    for (q = Lp[k] + 1; q < Lp[k + 1]; q++) {
+      Lx[q] = x[Li[q]] / pivot;
+      x[Li[q]] = 0;
+    }
+  }
+  return 1;
+}
+
+/*! The function is used in order to run the forward and backward
+   substitutions using the sparse LU decomposed matrix. */
+template <class nr_type_t>
+void eqnsys<nr_type_t>::substitute_lu_sparse (void) {
+  nr_type_t f;
+  int i, p;
+
+  // apply the row permutation to the right hand side
+  for (i = 0; i < N; i++) X_(pinv[i]) = B_(i);
+
+  // forward substitution in order to solve LY = B
+  for (i = 0; i < N; i++) {
+    f = X_(i);
+    // remember that the Lii diagonal are ones and stored first
+    for (p = Lp[i] + 1; p < Lp[i + 1]; p++) X_(Li[p]) -= Lx[p] * f;
+  }
+
+  // backward substitution in order to solve UX = Y
+  for (i = N - 1; i >= 0; i--) {
+    // the Uii diagonal is stored last
+    f = X_(i) / Ux[Up[i + 1] - 1];
+    X_(i) = f;
+    for (p = Up[i]; p < Up[i + 1] - 1; p++) X_(Ui[p]) -= Ux[p] * f;
+  }
+}
+
 /*! The function solves the equation system using a full-step iterative
    method (called Jacobi's method) or a single-step method (called
    Gauss-Seidel) depending on the given algorithm.  If the current X
@@ -655,6 +1585,476 @@ void eqnsys<nr_type_t>::solve_sor (void) {
 #endif
 }
 
+/*! The function solves the linear equation system using a Krylov
+   subspace method, either the restarted GMRES or the BiCGStab
+   algorithm, both with an incomplete LU decomposition of the matrix
+   as (right) preconditioner.  The matrix is copied into compressed
+   rows once it has changed, the matrix passed to the equation system
+   remains untouched.  The current X vector serves as initial guess
+   for the iteration, e.g. the solution of the previous frequency
+   during an AC analysis.  If the iteration does not converge the
+   system is solved using a LU decomposition, without a matrix a
+   no-convergence exception is thrown instead. */
+template <class nr_type_t>
+void eqnsys<nr_type_t>::solve_krylov (void) {
+  int i, conv;
+
+  // prepare matrix and preconditioner if necessary
+  if (update && Kmul == NULL) factorize_ilu ();
+
+  // the current X vector is a good initial guess for the iteration,
+  // the system is scaled to avoid tiny (denormal) right hand sides
+  std::vector<nr_type_t> x (N), b (N);
+  double s = 0;
+  for (i = 0; i < N; i++) s = std::max (s, abs (B_(i)));
+  if (s == 0 || !std::isfinite (s)) s = 1;
+  for (i = 0; i < N; i++) {
+    x[i] = X_(i) / s;
+    b[i] = B_(i) / s;
+    if (!std::isfinite (abs (x[i]))) x[i] = 0;
+  }
+
+  if (algo == ALGO_GMRES)
+    conv = solve_gmres (x.data (), b.data ());
+  else
+    conv = solve_bicgstab (x.data (), b.data ());
+
+  if (!conv) {
+    logprint (LOG_ERROR,
+	      "WARNING: no convergence after %d %s iterations "
+	      "(residual %g)\n", iterations,
+	      algo == ALGO_GMRES ? "gmres" : "bicgstab", residual);
+    // without a matrix keep the best approximation available and let
+    // the caller decide about it
+    if (Kmul != NULL) {
+      for (i = 0; i < N; i++) X_(i) = x[i] * s;
+      qucs::exception * e = new qucs::exception (EXCEPTION_NO_CONVERGENCE);
+      e->setText ("no convergence in matrix-free %s iterations",
+		  algo == ALGO_GMRES ? "gmres" : "bicgstab");
+      throw_exception (e);
+      return;
+    }
+    // fall back to a direct solution
+    update = 1;
+    if (As != NULL)
+      solve_lu_sparse ();
+    else
+      solve_lu_crout ();
+    return;
+  }
+  for (i = 0; i < N; i++) X_(i) = x[i] * s;
+}
+
+/*! The function copies the matrix of the equation system into
+   compressed rows (Kp, Ki, Kx) and computes the incomplete LU
+   decomposition without fill-in (ILU(0)) of that matrix as
+   preconditioner for the Krylov subspace methods.  Since the
+   diagonal of MNA matrices has zeros in the rows of voltage sources,
+   the rows are permuted to get a zero-free diagonal first (maximum
+   transversal).  The factors of the row permuted matrix are stored
+   in compressed rows (Mp, Mi, Mx) with the diagonal positions in Md
+   and the original row numbers in Mr. */
+template <class nr_type_t>
+void eqnsys<nr_type_t>::factorize_ilu (void) {
+  int i, k, p, q, r, c, top;
+
+  // copy the matrix into compressed rows
+  Kp.assign (N + 1, 0);
+  if (As != NULL) {
+    int * Ap = As->getColPtr ();
+    int * Ai = As->getRowIdx ();
+    nr_type_t * Ax = As->getData ();
+    for (p = 0; p < Ap[N]; p++) Kp[Ai[p] + 1]++;
+    for (r = 0; r < N; r++) Kp[r + 1] += Kp[r];
+    Ki.resize (Kp[N]);
+    Kx.resize (Kp[N]);
+    std::vector<int> next (Kp.begin (), Kp.end () - 1);
+    for (c = 0; c < N; c++) {
+      for (p = Ap[c]; p < Ap[c + 1]; p++) {
+	q = next[Ai[p]]++;
+	Ki[q] = c;
+	Kx[q] = Ax[p];
+      }
+    }
+  }
+  else {
+    Ki.clear ();
+    Kx.clear ();
+    for (r = 0; r < N; r++) {
+      for (c = 0; c < N; c++) {
+	if (A_(r, c) != nr_type_t (0)) {
+	  Ki.push_back (c);
+	  Kx.push_back (A_(r, c));
+	}
+      }
+      Kp[r + 1] = Ki.size ();
+    }
+  }
+
+  // match each column to a row with a non-zero entry in that column,
+  // numerically non-zero diagonal entries are taken as they are
+  std::vector<int> cmatch (N, -1), rmatch (N, -1), mark (N, -1);
+  for (r = 0; r < N; r++) {
+    for (p = Kp[r]; p < Kp[r + 1]; p++) {
+      if (Ki[p] == r && Kx[p] != nr_type_t (0)) {
+	cmatch[r] = r;
+	rmatch[r] = r;
+      }
+    }
+  }
+  // augmenting paths (depth-first search) for the remaining rows
+  std::vector<int> stack (N), pos (N), via (N);
+  for (i = 0; i < N; i++) {
+    if (rmatch[i] >= 0) continue;
+    stack[0] = i;
+    pos[0] = Kp[i];
+    top = 0;
+    while (top >= 0) {
+      r = stack[top];
+      c = -1;
+      // look for a free column of a newly visited row first, this
+      // keeps the paths short
+      if (pos[top] == Kp[r]) {
+	for (p = Kp[r]; p < Kp[r + 1] && c < 0; p++)
+	  if (Kx[p] != nr_type_t (0) && cmatch[Ki[p]] < 0) c = Ki[p];
+	if (c >= 0) {
+	  // flip the matching along the path
+	  via[top] = c;
+	  for (k = top; k >= 0; k--) {
+	    cmatch[via[k]] = stack[k];
+	    rmatch[stack[k]] = via[k];
+	  }
+	  break;
+	}
+      }
+      // otherwise continue with the row an unvisited column is matched to
+      while (pos[top] < Kp[r + 1]) {
+	p = pos[top]++;
+	if (Kx[p] == nr_type_t (0) || mark[Ki[p]] == i) continue;
+	c = Ki[p];
+	mark[c] = i;
+	break;
+      }
+      if (c < 0) {
+	// row exhausted, backtrack
+	top--;
+	continue;
+      }
+      via[top++] = c;
+      stack[top] = cmatch[c];
+      pos[top] = Kp[cmatch[c]];
+    }
+  }
+  // structurally singular matrices, any free column will do
+  for (c = 0, r = 0; r < N; r++) {
+    if (rmatch[r] >= 0) continue;
+    while (cmatch[c] >= 0) c++;
+    cmatch[c] = r;
+    rmatch[r] = c;
+  }
+  Mr.assign (cmatch.begin (), cmatch.end ());
+
+  // row permuted copy of the matrix including all diagonal entries
+  Mp.assign (N + 1, 0);
+  Md.resize (N);
+  Mi.clear ();
+  Mx.clear ();
+  for (i = 0; i < N; i++) {
+    r = Mr[i];
+    for (Md[i] = -1, p = Kp[r]; p < Kp[r + 1]; p++) {
+      if (Md[i] < 0 && Ki[p] >= i) {
+	Md[i] = Mi.size ();
+	if (Ki[p] != i) {
+	  Mi.push_back (i);
+	  Mx.push_back (0);
+	}
+      }
+      Mi.push_back (Ki[p]);
+      Mx.push_back (Kx[p]);
+    }
+    if (Md[i] < 0) {
+      Md[i] = Mi.size ();
+      Mi.push_back (i);
+      Mx.push_back (0);
+    }
+    Mp[i + 1] = Mi.size ();
+  }
+
+  // incomplete LU decomposition (row-wise, no fill-in)
+  std::vector<int> w (N, -1);
+  double d, MaxRow;
+  nr_type_t f;
+  for (i = 0; i < N; i++) {
+    for (p = Mp[i]; p < Mp[i + 1]; p++) w[Mi[p]] = p;
+    for (p = Mp[i]; p < Md[i]; p++) {
+      k = Mi[p];
+      f = Mx[p] /= Mx[Md[k]];
+      for (q = Md[k] + 1; q < Mp[k + 1]; q++)
+	if (w[Mi[q]] >= 0) Mx[w[Mi[q]]] -= f * Mx[q];
+    }
+    // replace zero pivots by a small value relative to the row
+    for (MaxRow = 0, p = Mp[i]; p < Mp[i + 1]; p++) {
+      if ((d = abs (Mx[p])) > MaxRow) MaxRow = d;
+      w[Mi[p]] = -1;
+    }
+    if (abs (Mx[Md[i]]) <= MaxRow * std::numeric_limits<double>::epsilon ())
+      Mx[Md[i]] = MaxRow > 0 ? MaxRow * 1e-8 : 1;
+  }
+}
+
+/*! This function applies the incomplete LU preconditioner, i.e. it
+   replaces the given vector by the solution of LU z = P v using
+   forward and backward substitutions. */
+template <class nr_type_t>
+void eqnsys<nr_type_t>::substitute_ilu (nr_type_t * v) {
+  std::vector<nr_type_t> y (N);
+  nr_type_t f;
+  int i, p;
+
+  // matrix-free operation
+  if (Kmul != NULL) {
+    if (Kpre != NULL) {
+      std::copy (v, v + N, y.begin ());
+      (*Kpre) (Kdata, y.data (), v);
+    }
+    return;
+  }
+
+  // forward substitution in order to solve LY = PV
+  for (i = 0; i < N; i++) {
+    f = v[Mr[i]];
+    for (p = Mp[i]; p < Md[i]; p++) f -= Mx[p] * y[Mi[p]];
+    y[i] = f;
+  }
+
+  // backward substitution in order to solve UZ = Y
+  for (i = N - 1; i >= 0; i--) {
+    f = y[i];
+    for (p = Md[i] + 1; p < Mp[i + 1]; p++) f -= Mx[p] * v[Mi[p]];
+    v[i] = f / Mx[Md[i]];
+  }
+}
+
+// The function computes the matrix-vector product y = A * x.
+template <class nr_type_t>
+void eqnsys<nr_type_t>::multiply_krylov (const nr_type_t * x,
+					 nr_type_t * y) {
+  nr_type_t f;
+  if (Kmul != NULL) {
+    (*Kmul) (Kdata, x, y);
+    return;
+  }
+  for (int r = 0; r < N; r++) {
+    f = 0;
+    for (int p = Kp[r]; p < Kp[r + 1]; p++) f += Kx[p] * x[Ki[p]];
+    y[r] = f;
+  }
+}
+
+// Helper functions for the Krylov subspace methods.
+template <class nr_type_t>
+static nr_type_t krylov_dot (const std::vector<nr_type_t> & a,
+			     const std::vector<nr_type_t> & b) {
+  nr_type_t f = 0;
+  for (std::size_t i = 0; i < a.size (); i++) f += conj (a[i]) * b[i];
+  return f;
+}
+
+// scaled euclidian norm, avoids underflow for tiny residuals
+template <class nr_type_t>
+static double krylov_norm (const std::vector<nr_type_t> & a) {
+  double f = 0, s = 0;
+  for (std::size_t i = 0; i < a.size (); i++) s = std::max (s, abs (a[i]));
+  if (s == 0 || !std::isfinite (s)) return s;
+  for (std::size_t i = 0; i < a.size (); i++) f += norm (a[i] / s);
+  return s * std::sqrt (f);
+}
+
+/*! The function returns the componentwise relative residual
+   max |r_i| / (|A| * |x| + |b|)_i of the given solution.  Unlike the
+   norm of the residual it does not depend on the scaling of the rows,
+   which is important for MNA matrices mixing currents and voltages.
+   Without a matrix the normwise relative residual |r| / |b| is
+   returned. */
+template <class nr_type_t>
+double eqnsys<nr_type_t>::error_krylov (const nr_type_t * x,
+					const nr_type_t * b,
+					const nr_type_t * r) {
+  double d, f, e = 0;
+  if (Kmul != NULL) {
+    std::vector<nr_type_t> rv (r, r + N), bv (b, b + N);
+    d = krylov_norm (bv);
+    f = krylov_norm (rv);
+    return d != 0 ? f / d : f;
+  }
+  for (int i = 0; i < N; i++) {
+    d = abs (b[i]);
+    for (int p = Kp[i]; p < Kp[i + 1]; p++) d += abs (Kx[p]) * abs (x[Ki[p]]);
+    if (d != 0)
+      f = abs (r[i]) / d;
+    else
+      f = abs (r[i]) > 0 ? std::numeric_limits<double>::infinity () : 0;
+    if (!(f <= e)) e = f; // keep NaNs
+  }
+  return e;
+}
+
+/*! The function runs the restarted GMRES algorithm with right
+   preconditioning starting at the given solution vector.  Givens
+   rotations keep the Hessenberg matrix of the Arnoldi process upper
+   triangular.  Each restart cycle aims at reducing the norm of the
+   residual by the factor the componentwise residual is still away
+   from the tolerance.  It returns non-zero on convergence. */
+template <class nr_type_t>
+int eqnsys<nr_type_t>::solve_gmres (nr_type_t * x, const nr_type_t * b) {
+  int MaxIter = KmaxIter > 0 ? KmaxIter : std::max (N, 100);
+  int m = std::min (N, 50); // restart
+  double reltol = Ktol;
+  double beta, tol, d;
+  nr_type_t f, t;
+  int i, j, k;
+
+  std::vector<std::vector<nr_type_t> > V (m + 1, std::vector<nr_type_t> (N));
+  std::vector<std::vector<nr_type_t> > H (m + 1, std::vector<nr_type_t> (m));
+  std::vector<nr_type_t> g (m + 1), s (m), y (m), u (N), r (N);
+  std::vector<double> c (m);
+
+  // initial residual
+  multiply_krylov (x, r.data ());
+  for (i = 0; i < N; i++) r[i] = b[i] - r[i];
+  residual = error_krylov (x, b, r.data ());
+  iterations = 0;
+
+  while (residual > reltol && std::isfinite (residual) &&
+	 iterations < MaxIter) {
+    beta = krylov_norm (r);
+    tol = 0.5 * beta * reltol / residual;
+    for (i = 0; i < N; i++) V[0][i] = r[i] / beta;
+    std::fill (g.begin (), g.end (), 0);
+    g[0] = beta;
+
+    // Arnoldi process using modified Gram-Schmidt
+    for (j = 0; j < m && iterations < MaxIter; ) {
+      u = V[j];
+      substitute_ilu (u.data ());
+      multiply_krylov (u.data (), V[j + 1].data ());
+      for (i = 0; i <= j; i++) {
+	H[i][j] = f = krylov_dot (V[i], V[j + 1]);
+	for (k = 0; k < N; k++) V[j + 1][k] -= f * V[i][k];
+      }
+      H[j + 1][j] = d = krylov_norm (V[j + 1]);
+      if (d > 0) for (k = 0; k < N; k++) V[j + 1][k] /= d;
+
+      // apply previous rotations to the new column
+      for (i = 0; i < j; i++) {
+	t = c[i] * H[i][j] + s[i] * H[i + 1][j];
+	H[i + 1][j] = -conj (s[i]) * H[i][j] + c[i] * H[i + 1][j];
+	H[i][j] = t;
+      }
+      // compute and apply new rotation eliminating H[j+1][j]
+      if (abs (H[j][j]) == 0) {
+	c[j] = 0;
+	s[j] = 1;
+      }
+      else {
+	d = std::sqrt (norm (H[j][j]) + norm (H[j + 1][j]));
+	c[j] = abs (H[j][j]) / d;
+	s[j] = H[j][j] / abs (H[j][j]) * conj (H[j + 1][j]) / d;
+      }
+      H[j][j] = c[j] * H[j][j] + s[j] * H[j + 1][j];
+      H[j + 1][j] = 0;
+      g[j + 1] = -conj (s[j]) * g[j];
+      g[j] = c[j] * g[j];
+      iterations++;
+      j++;
+      if (abs (g[j]) <= tol || d == 0) break;
+    }
+
+    // solve the upper triangular system and update the solution
+    for (i = j - 1; i >= 0; i--) {
+      f = g[i];
+      for (k = i + 1; k < j; k++) f -= H[i][k] * y[k];
+      y[i] = f / H[i][i];
+    }
+    std::fill (u.begin (), u.end (), 0);
+    for (i = 0; i < j; i++)
+      for (k = 0; k < N; k++) u[k] += y[i] * V[i][k];
+    substitute_ilu (u.data ());
+    for (k = 0; k < N; k++) x[k] += u[k];
+
+    // true residual
+    multiply_krylov (x, r.data ());
+    for (i = 0; i < N; i++) r[i] = b[i] - r[i];
+    residual = error_krylov (x, b, r.data ());
+  }
+  return residual <= reltol;
+}
+
+/*! The function runs the stabilized bi-conjugate gradient algorithm
+   with right preconditioning starting at the given solution vector.
+   The iteration is restarted with the true residual once the updated
+   residual converged (but the true one did not) or on breakdown.  It
+   returns non-zero on convergence. */
+template <class nr_type_t>
+int eqnsys<nr_type_t>::solve_bicgstab (nr_type_t * x, const nr_type_t * b) {
+  int MaxIter = KmaxIter > 0 ? KmaxIter : std::max (N, 100);
+  double reltol = Ktol;
+  nr_type_t rho, alpha, omega, rhonew, beta;
+  int i, k;
+
+  std::vector<nr_type_t> r (N), rh (N), p (N), v (N), s (N), t (N);
+  std::vector<nr_type_t> ph (N), sh (N);
+
+  iterations = 0;
+  for (;;) {
+    // (re)start with the true residual
+    multiply_krylov (x, r.data ());
+    for (i = 0; i < N; i++) r[i] = b[i] - r[i];
+    residual = error_krylov (x, b, r.data ());
+    if (residual <= reltol || !std::isfinite (residual) ||
+	iterations >= MaxIter)
+      break;
+    rh = r;
+    rho = alpha = omega = 1;
+    std::fill (p.begin (), p.end (), 0);
+    std::fill (v.begin (), v.end (), 0);
+
+    for (k = 0; iterations < MaxIter; k++) {
+      iterations++;
+      rhonew = krylov_dot (rh, r);
+      beta = (rhonew / rho) * (alpha / omega);
+      for (i = 0; i < N; i++) p[i] = r[i] + beta * (p[i] - omega * v[i]);
+      ph = p;
+      substitute_ilu (ph.data ());
+      multiply_krylov (ph.data (), v.data ());
+      alpha = rhonew / krylov_dot (rh, v);
+      if (rhonew == nr_type_t (0) || !std::isfinite (abs (alpha))) {
+	// breakdown, give up if restarting did not help
+	if (k == 0) return 0;
+	break;
+      }
+      for (i = 0; i < N; i++) {
+	s[i] = r[i] - alpha * v[i];
+	x[i] += alpha * ph[i];
+      }
+      if (!(error_krylov (x, b, s.data ()) > reltol)) break;
+      sh = s;
+      substitute_ilu (sh.data ());
+      multiply_krylov (sh.data (), t.data ());
+      omega = krylov_dot (t, s) / krylov_dot (t, t);
+      if (omega == nr_type_t (0) || !std::isfinite (abs (omega)))
+	break; // breakdown
+      for (i = 0; i < N; i++) {
+	x[i] += omega * sh[i];
+	r[i] = s[i] - omega * t[i];
+      }
+      if (!(error_krylov (x, b, r.data ()) > reltol)) break;
+      rho = rhonew;
+    }
+  }
+  return residual <= reltol;
+}
+
 /*! The function computes the convergence criteria for iterative
    methods like Jacobi or Gauss-Seidel as defined by Schmidt and
    v.Mises. */
@@ -41,6 +41,20 @@ enum algo_type {
   ALGO_SV_DECOMPOSITION = 0x1000,
   // testing
   ALGO_QR_DECOMPOSITION_2 = 0x2000,
+  // sparse matrices
+  ALGO_LU_FACTORIZATION_SPARSE = 0x4000,
+  ALGO_LU_SUBSTITUTION_SPARSE = 0x8000,
+  ALGO_LU_DECOMPOSITION_SPARSE = 0xC000,
+  // cache-blocked dense matrices, substitution as for Doolittle
+  ALGO_LU_FACTORIZATION_BLOCKED = 0x10000,
+  ALGO_LU_DECOMPOSITION_BLOCKED = 0x10040,
+  // preconditioned Krylov subspace methods
+  ALGO_GMRES = 0x20000,
+  ALGO_BICGSTAB = 0x40000,
+  // dense LU decomposition in single precision with iterative refinement
+  ALGO_LU_FACTORIZATION_MIXED = 0x80000,
+  ALGO_LU_SUBSTITUTION_MIXED = 0x100000,
+  ALGO_LU_DECOMPOSITION_MIXED = 0x180000,
 };
 
 enum pivot_type {
@@ -49,11 +63,19 @@ enum pivot_type {
   PIVOT_FULL = 0x04,
 };
 
+#include <complex>
+#include <vector>
+
 #include "tmatrix.h"
+#include "tspmatrix.h"
 #include "tvector.h"
 
 namespace qucs {
 
+// single precision type of the mixed precision LU factors
+template <class nr_type_t> struct eqnsys_single { typedef float type; };
+template <> struct eqnsys_single<std::complex<double>> { typedef std::complex<float> type; };
+
 template <class nr_type_t> class eqnsys {
 public:
   eqnsys();
@@ -61,11 +83,30 @@ public:
   ~eqnsys();
   void setAlgo(int a) { algo = a; }
   int getAlgo() { return algo; }
+  void setReuse(int r) { reuse = r; }
+  int getReuse() { return reuse; }
+  void setThreads(int t) { threads = t; }
+  int getThreads() { return threads; }
+  // tolerance and iteration limit of the Krylov methods, a limit of
+  // zero selects max(N, 100) iterations
+  void setKrylovTol(double t) { Ktol = t; }
+  void setKrylovMaxIter(int n) { KmaxIter = n; }
+  int getIterations() { return iterations; }
+  double getResidual() { return residual; }
   void passEquationSys(tmatrix<nr_type_t> *, tvector<nr_type_t> *, tvector<nr_type_t> *);
+  void passEquationSys(tspmatrix<nr_type_t> *, tvector<nr_type_t> *, tvector<nr_type_t> *);
+  // matrix-free operators y = A * x and y = M^-1 * x for the Krylov methods
+  typedef void (*operator_func_t)(void *, const nr_type_t *, nr_type_t *);
+  void passEquationSys(operator_func_t, operator_func_t, void *, tvector<nr_type_t> *, tvector<nr_type_t> *);
   void solve();
+  void invert(tmatrix<nr_type_t> *);
 
 private:
   int update;
+  int reuse;
+  int threads;
+  int iterations;
+  double residual;
   int algo;
   int pivoting;
   int *rMap;
@@ -75,6 +116,7 @@ private:
 
   tmatrix<nr_type_t> *A;
   tmatrix<nr_type_t> *V;
+  tspmatrix<nr_type_t> *As;
   tvector<nr_type_t> *B;
   tvector<nr_type_t> *X;
   tvector<nr_type_t> *R;
@@ -82,6 +124,26 @@ private:
   tvector<double> *S;
   tvector<double> *E;
 
+  // sparse LU factors (compressed columns) and row permutation
+  std::vector<int> Lp, Li, Up, Ui, pinv;
+  std::vector<nr_type_t> Lx, Ux;
+  // structure of the sparse matrix the factors have been computed for
+  std::vector<int> Sp, Si;
+  // matrix in compressed rows and its incomplete LU factors (row
+  // permuted, original row numbers in Mr) for the Krylov methods
+  std::vector<int> Kp, Ki, Mp, Mi, Md, Mr;
+  std::vector<nr_type_t> Kx, Mx;
+  // the operators replacing the matrix and preconditioner if non-NULL
+  operator_func_t Kmul, Kpre;
+  void *Kdata;
+  double Ktol;
+  int KmaxIter;
+  // single precision LU factors (Doolittle, row major) of the mixed
+  // precision decomposition, set if it fell back to double precision
+  std::vector<typename eqnsys_single<nr_type_t>::type> Fx;
+  int fallback;
+
+  void resize(int);
   void solve_inverse();
   void solve_gauss();
   void solve_gauss_jordan();
@@ -91,6 +153,20 @@ private:
   void factorize_lu_doolittle();
   void substitute_lu_crout();
   void substitute_lu_doolittle();
+  void substitute_lu_crout(tvector<nr_type_t> *, tvector<nr_type_t> *);
+  void substitute_lu_doolittle(tvector<nr_type_t> *, tvector<nr_type_t> *);
+  void solve_lu_blocked();
+  void factorize_lu_blocked();
+  void update_lu_blocked(int, int, int, int);
+  void solve_lu_mixed();
+  void factorize_lu_mixed();
+  void substitute_lu_mixed();
+  int refine_lu_mixed();
+  void solve_lu_sparse();
+  void factorize_lu_sparse();
+  int refactorize_lu_sparse();
+  void substitute_lu_sparse();
+  int reach_sparse(int, int, int *, int *, int *, int *, int);
   void solve_qr();
   void solve_qr_ls();
   void solve_qrh();
@@ -117,6 +193,13 @@ private:
   void diagonalize_svd();
   void solve_iterative();
   void solve_sor();
+  void solve_krylov();
+  void factorize_ilu();
+  void substitute_ilu(nr_type_t *);
+  void multiply_krylov(const nr_type_t *, nr_type_t *);
+  double error_krylov(const nr_type_t *, const nr_type_t *, const nr_type_t *);
+  int solve_gmres(nr_type_t *, const nr_type_t *);
+  int solve_bicgstab(nr_type_t *, const nr_type_t *);
   double convergence_criteria();
   void ensure_diagonal();
   void ensure_diagonal_MNA();
@@ -25,8 +25,8 @@
 
 using namespace qucs;
 
-// The global exception stack.
-exceptionstack qucs::estack;
+// The global exception stack, one per thread.
+thread_local exceptionstack qucs::estack;
 
 exceptionstack::exceptionstack() : root(nullptr) {}
 
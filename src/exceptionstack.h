@@ -40,8 +40,8 @@ private:
   exception *root;
 };
 
-// The global exception stack.
-extern exceptionstack estack;
+// The global exception stack, one per thread.
+extern thread_local exceptionstack estack;
 
 } /* namespace qucs */
 
@@ -19,117 +19,121 @@
  * Boston, MA 02110-1301, USA.
  */
 
+#include <algorithm>
+
 #include "history.h"
-#include "poly.h"
-#include "spline.h"
-#include "tvector.h"
 
 namespace qucs {
 
-/* Drops those values in the history which are newer than the specified time. */
-void history::truncate(const double tcut) {
-  std::size_t i;
-  std::size_t ts = this->t->size();
-  for (i = this->leftidx(); i < ts; i++) {
-    if ((*this->t)[i] > tcut) {
-      break;
+/* Appends the given value to the history.  Its number is the one of
+   the latest time value, a history not matching it (e.g. a new one)
+   starts over there. */
+void history::push_back(const double val) {
+  const std::size_t n = times ? times->end - 1 : end;
+  if (times && n != end) {
+    first = end = cursor = n;
+  }
+  if (times) {
+    first = oldest();
+  }
+  if (end - first == values.size()) {
+    grow();
+  }
+  values[n & (values.size() - 1)] = val;
+  end = n + 1;
+  if (times) {
+    // the slope of the new value is one-sided until the next one
+    // arrives, then the weighted harmonic mean of the adjacent ones,
+    // which is zero at extrema so the interpolation does not overshoot
+    const std::size_t mask = slopes.size() - 1;
+    slopes[n & mask] = 0.0;
+    if (n > oldest()) {
+      const double h1 = time(n) - time(n - 1);
+      const double d1 = h1 > 0.0 ? (val - value(n - 1)) / h1 : 0.0;
+      slopes[n & mask] = d1;
+      if (n - 1 > oldest()) {
+        const double h0 = time(n - 1) - time(n - 2);
+        const double d0 = h0 > 0.0 ? (value(n - 1) - value(n - 2)) / h0 : 0.0;
+        const double w0 = 2 * h1 + h0, w1 = h1 + 2 * h0;
+        slopes[(n - 1) & mask] = d0 * d1 > 0.0 ? (w0 + w1) / (w0 / d0 + w1 / d1) : 0.0;
+      } else {
+        slopes[(n - 1) & mask] = d1;
+      }
     }
+    drop();
   }
-  this->resize(ts - i);
 }
 
-/* Drops those values in the history which are older than the specified age
- * of the history instance. */
-void history::drop() {
-  if (this->values->empty()) {
-    return;
-  }
-  double f = this->first();
-  double l = this->last();
-  if (age > 0.0 && l - f > age) {
-    std::size_t r;
-    std::size_t i = this->leftidx();
-    for (r = 0; i < this->t->size(); r++, i++)
-      if (l - (*this->t)[i] < age)
-        break;
-    // keep 2 values being older than specified age
-    r += this->unused();
-    if (r >= 2)
-      r -= 2;
-    r = std::min(r, this->values->size() - 1);
-    if (r > 127)
-      /* erase the first r value */
-      this->values->erase(this->values->begin(), this->values->begin() + r);
+/* Doubles the capacity of the ring buffer keeping the numbering of
+   the samples. */
+void history::grow() {
+  const std::size_t size = std::max<std::size_t>(16, 2 * values.size());
+  std::vector<double> v(size), s(times ? size : 0);
+  for (std::size_t n = first; n < end; n++) {
+    v[n & (size - 1)] = value(n);
+    if (times)
+      s[n & (size - 1)] = slope(n);
   }
+  values.swap(v);
+  slopes.swap(s);
 }
 
-/* Interpolates a value using 2 left side and 2 right side values if possible. */
-double history::interpol(double tval, int idx, bool left) {
-  static spline spl(SPLINE_BC_NATURAL);
-  static tvector<double> x(4);
-  static tvector<double> y(4);
+/* Drops those values in the history which are newer than the specified time. */
+void history::truncate(const double tcut) {
+  while (end > oldest() && time(end - 1) > tcut) {
+    end--;
+  }
+  cursor = std::min(cursor, end);
+}
 
-  unsigned int n = left ? idx + 1 : idx;
-  if (n > 1 && n + 2 < this->values->size()) {
-    int i, k, l = this->leftidx();
-    for (k = 0, i = n - 2; k < 4; i++, k++) {
-      x(k) = (*this->t)[i + l];
-      y(k) = (*this->values)[i];
-    }
-    spl.vectors(y, x);
-    spl.construct();
-    return spl.evaluate(tval).f0;
+/* Drops those values in the history which are older than the specified
+   age of the history instance, keeping the latest one not younger than
+   it as the start of the interval a delayed lookup falls into. */
+void history::drop() {
+  if (age <= 0.0 || end == first) {
+    return;
+  }
+  const double t = last() - age;
+  first = oldest();
+  while (first + 1 < end && time(first + 1) <= t) {
+    first++;
   }
-  return (*this->values)[idx];
 }
 
-/* Returns the value nearest to the given time value.
- * If the optional parameter is true then additionally cubic spline interpolation is used. */
+/* Returns the value at the given time value.  If the optional parameter
+   is true the value is interpolated using the cubic Hermite polynomial
+   of the enclosing interval, otherwise it is the value nearest in time. */
 double history::nearest(double tval, bool interpolate) {
-  if (t->empty()) {
+  const std::size_t lo = oldest();
+  if (end == lo) {
     return 0.0;
   }
-  int l = this->leftidx();
-  int r = t->size() - 1;
-  int i = -1;
-  double diff = std::numeric_limits<double>::max();
-  sign = true;
-  i = seek(tval, l, r, diff, i);
-  i = i - l;
-  if (interpolate) {
-    return interpol(tval, i, sign);
+  const std::size_t hi = end - 1;
+  if (tval <= time(lo)) {
+    return value(lo);
+  }
+  if (tval >= time(hi)) {
+    return value(hi);
   }
-  return (*this->values)[i];
-}
 
-/* The function is utilized in order to find the nearest value to a
-   given time value.  Since the time vector is ordered a recursive
-   lookup algorithm can be used.  The function returns the current
-   index into the time vector as well as the error in time. */
-int history::seek(double tval, int l, int r, double &diff, int idx) {
-  int i = (l + r) / 2;
-  if (l == r) {
-    return i;
+  // move the cursor to the interval containing the time value
+  std::size_t n = std::min(std::max(cursor, lo), hi - 1);
+  while (time(n) > tval) {
+    n--;
   }
-  double v = (*this->t)[i];
-  double d = v - tval;
-  if (fabs(d) < diff) {
-    // better approximation
-    diff = fabs(d);
-    sign = d < 0.0 ? true : false;
-    idx = i;
-  } else if (i == l) {
-    // no better
-    return idx;
+  while (time(n + 1) <= tval) {
+    n++;
   }
-  if (d < 0.0) {
-    // look later
-    return seek(tval, i, r, diff, idx);
-  } else if (d > 0.0) {
-    // look earlier
-    return seek(tval, l, i, diff, idx);
+  cursor = n;
+
+  const double t0 = time(n), h = time(n + 1) - t0;
+  const double y0 = value(n), y1 = value(n + 1);
+  if (!interpolate) {
+    return tval - t0 < t0 + h - tval ? y0 : y1;
   }
-  return idx;
+  const double s = (tval - t0) / h, s2 = s * s, s3 = s2 * s;
+  return (2 * s3 - 3 * s2 + 1) * y0 + (s3 - 2 * s2 + s) * h * slope(n) + (-2 * s3 + 3 * s2) * y1 +
+         (s3 - s2) * h * slope(n + 1);
 }
 
 } // namespace qucs
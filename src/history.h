@@ -22,84 +22,72 @@
 #ifndef __HISTORY_H__
 #define __HISTORY_H__
 
-#include <memory>
-#include <utility>
+#include <cstddef>
 #include <vector>
 
 namespace qucs {
 
+/* The history of a transient quantity as a delay line.  The samples
+   are kept in a ring buffer which holds those not older than the age
+   of the history (plus the one just before) and grows only as long as
+   this span needs more samples.  Samples are numbered consecutively
+   since the start of the history, the n-th sample lives in the slot
+   n modulo the (power of two) capacity.
+
+   The time values are held by a separate history the value histories
+   are applied to, the n-th value belongs to its n-th time value.  Each
+   value gets its (monotonicity preserving) slope when the following
+   value arrives, values between the samples are then given by the
+   cubic Hermite polynomial of the enclosing interval.  The interval
+   of the last lookup is kept as a cursor: the delayed time of a
+   component moves forward with the simulation time, and back a
+   little on rejected time steps, so the next lookup usually needs a
+   step or two only. */
 class history {
 public:
-  history()
-      : sign(false), age(0), values(std::make_shared<std::vector<double>>()),
-        t(std::make_shared<std::vector<double>>()) {};
-
+  history() : age(0), times(nullptr), first(0), end(0), cursor(0) {}
   history(const history &h) = delete;
 
   /* Appends the given value to the history. */
-  void push_back(const double val) {
-    this->values->push_back(val);
-    if (this->values != this->t) {
-      this->drop();
-    }
-  }
-
-  /* Drops the most recent n values in the history. */
-  void truncate(const std::size_t n) = delete;
-  void resize(const std::size_t n) {
-    this->t->resize(n);
-    this->values->resize(n);
-  }
+  void push_back(double);
 
-  std::size_t size() const { return t->size(); }
+  std::size_t size() const { return end - oldest(); }
 
   void setAge(const double a) { this->age = a; }
   double getAge() const { return this->age; }
 
-  void apply(const history &h) { this->t = h.t; }
+  /* Uses the time values of the given history. */
+  void apply(const history &h) { this->times = &h; }
 
   // Returns the last (youngest) time value in the history
-  double last() const { return this->t->empty() ? 0.0 : this->t->back(); }
-
-  // Returns the first (oldest) time value in the history.
-  double first() const { return this->t->empty() ? 0.0 : (*this->t)[leftidx()]; }
-
-  // Returns left-most valid index into the time value vector.
-  unsigned int leftidx() const {
-    int ts = this->t->size();
-    int vs = this->values->size();
-    return ts - vs > 0 ? ts - vs : 0;
-  }
-
-  /* Returns number of unused values (time value vector shorter than value vector). */
-  std::size_t unused() {
-    int ts = t->size();
-    int vs = values->size();
-    return vs - ts > 0 ? vs - ts : 0;
-  }
-
-  // Returns the duration of the history.
-  double duration() const { return last() - first(); }
-
-  void truncate(const double);
+  double last() const { return end > oldest() ? time(end - 1) : 0.0; }
 
+  void truncate(double);
   void drop();
-  void self() { this->t = this->values; }
 
-  double interpol(double, int, bool);
   double nearest(double, bool interpolate = true);
-  int seek(double, int, int, double &, int);
 
-  double getTfromidx(const int idx) { return this->t == nullptr ? 0.0 : (*this->t)[idx]; }
-  double getValfromidx(const int idx) {
-    return this->values == nullptr ? 0.0 : (*this->values)[idx];
+  double getTfromidx(const int idx) const { return time(oldest() + idx); }
+  double getValfromidx(const int idx) const { return value(oldest() + idx); }
+
+private:
+  double time(std::size_t n) const {
+    return times ? times->value(n) : values[n & (values.size() - 1)];
   }
+  double value(std::size_t n) const { return values[n & (values.size() - 1)]; }
+  double slope(std::size_t n) const { return slopes[n & (slopes.size() - 1)]; }
+  // Returns the number of the oldest sample having a time value.
+  std::size_t oldest() const { return times && times->first > first ? times->first : first; }
+  void grow();
 
 private:
-  bool sign;
   double age;
-  std::shared_ptr<std::vector<double>> values;
-  std::shared_ptr<std::vector<double>> t;
+  const history *times; // the history holding the time values, none if itself
+  std::vector<double> values;
+  std::vector<double> slopes;
+  std::size_t first;  // number of the oldest sample kept
+  std::size_t end;    // number of the next sample
+  std::size_t cursor; // number of the sample starting the last looked up interval
 };
 
 } // namespace qucs
@@ -0,0 +1,195 @@
+/*
+ * tspmatrix.cpp - sparse matrix template class implementation
+ *
+ * This is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this package; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street - Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstdio>
+
+#include "complex.h"
+#include "tmatrix.h"
+#include "tspmatrix.h"
+
+namespace qucs {
+
+// Creates an empty instance of the tspmatrix class.
+template <class nr_type_t> tspmatrix<nr_type_t>::tspmatrix() {
+  rows = cols = 0;
+  compressed = false;
+  colptr.assign(1, 0);
+}
+
+/* Creates a square sparse matrix of the given size without any
+   structural non-zero entries. */
+template <class nr_type_t> tspmatrix<nr_type_t>::tspmatrix(int s) {
+  assert(s >= 0);
+  rows = cols = s;
+  compressed = false;
+  colptr.assign(s + 1, 0);
+}
+
+/* Registers the given position as a structural non-zero entry.
+   Duplicate positions are allowed and merged by compress(). */
+template <class nr_type_t> void tspmatrix<nr_type_t>::insert(const int r, const int c) {
+  assert(r >= 0 && r < rows && c >= 0 && c < cols);
+  pending.push_back({c, r});
+  compressed = false;
+}
+
+/* Builds the compressed column structure from all the positions
+   registered so far (including the ones of a previously compressed
+   structure).  All values are reset to zero. */
+template <class nr_type_t> void tspmatrix<nr_type_t>::compress() {
+  // merge the existing structure with the pending entries
+  for (int c = 0; c < cols; c++) {
+    for (int i = colptr[c]; i < colptr[c + 1]; i++) {
+      pending.push_back({c, rowidx[i]});
+    }
+  }
+  std::sort(pending.begin(), pending.end());
+  pending.erase(std::unique(pending.begin(), pending.end()), pending.end());
+
+  // create column pointers and row indices
+  colptr.assign(cols + 1, 0);
+  rowidx.resize(pending.size());
+  for (std::size_t i = 0; i < pending.size(); i++) {
+    colptr[pending[i].first + 1]++;
+    rowidx[i] = pending[i].second;
+  }
+  for (int c = 0; c < cols; c++) {
+    colptr[c + 1] += colptr[c];
+  }
+  data.assign(pending.size(), 0);
+
+  pending.clear();
+  pending.shrink_to_fit();
+  compressed = true;
+}
+
+/* Returns the position of the given entry inside the data array or -1
+   if the entry is not a structural non-zero. */
+template <class nr_type_t> int tspmatrix<nr_type_t>::find(const int r, const int c) const {
+  assert(compressed && r >= 0 && r < rows && c >= 0 && c < cols);
+  auto first = rowidx.begin() + colptr[c];
+  auto last = rowidx.begin() + colptr[c + 1];
+  auto it = std::lower_bound(first, last, r);
+  if (it == last || *it != r)
+    return -1;
+  return (int)(it - rowidx.begin());
+}
+
+// Returns the matrix element at the given row and column.
+template <class nr_type_t> nr_type_t tspmatrix<nr_type_t>::get(const int r, const int c) const {
+  int i = find(r, c);
+  return i < 0 ? 0 : data[i];
+}
+
+/* Sets the matrix element at the given row and column.  The entry must
+   be part of the structure unless the value is zero. */
+template <class nr_type_t> void tspmatrix<nr_type_t>::set(const int r, const int c, nr_type_t z) {
+  int i = find(r, c);
+  assert(i >= 0 || z == nr_type_t(0));
+  if (i >= 0)
+    data[i] = z;
+}
+
+/* Adds the given value to the matrix element at the given row and
+   column.  The entry must be part of the structure unless the value
+   is zero. */
+template <class nr_type_t> void tspmatrix<nr_type_t>::add(const int r, const int c, nr_type_t z) {
+  int i = find(r, c);
+  assert(i >= 0 || z == nr_type_t(0));
+  if (i >= 0)
+    data[i] += z;
+}
+
+// Sets all structural non-zero elements to the given value.
+template <class nr_type_t> void tspmatrix<nr_type_t>::set(nr_type_t z) {
+  std::fill(data.begin(), data.end(), z);
+}
+
+// Transposes the matrix in place, the structure is transposed as well.
+template <class nr_type_t> void tspmatrix<nr_type_t>::transpose() {
+  assert(compressed);
+  std::vector<int> tptr(rows + 1, 0);
+  std::vector<int> tidx(rowidx.size());
+  std::vector<nr_type_t> tdata(data.size());
+
+  // count entries per row, these become the new columns
+  for (std::size_t i = 0; i < rowidx.size(); i++) {
+    tptr[rowidx[i] + 1]++;
+  }
+  for (int r = 0; r < rows; r++) {
+    tptr[r + 1] += tptr[r];
+  }
+
+  // scatter entries, row indices remain sorted since columns are visited in order
+  std::vector<int> next(tptr.begin(), tptr.end() - 1);
+  for (int c = 0; c < cols; c++) {
+    for (int i = colptr[c]; i < colptr[c + 1]; i++) {
+      int k = next[rowidx[i]]++;
+      tidx[k] = c;
+      tdata[k] = data[i];
+    }
+  }
+
+  std::swap(rows, cols);
+  colptr.swap(tptr);
+  rowidx.swap(tidx);
+  data.swap(tdata);
+}
+
+// Checks validity of matrix.
+template <class nr_type_t> int tspmatrix<nr_type_t>::isFinite() {
+  for (std::size_t i = 0; i < data.size(); i++) {
+    if (!std::isfinite(real(data[i]))) {
+      return 0;
+    }
+  }
+  return 1;
+}
+
+// Returns a dense copy of the sparse matrix.
+template <class nr_type_t> tmatrix<nr_type_t> tspmatrix<nr_type_t>::getDense() {
+  tmatrix<nr_type_t> res(rows, cols);
+  for (int c = 0; c < cols; c++) {
+    for (int i = colptr[c]; i < colptr[c + 1]; i++) {
+      res(rowidx[i], c) = data[i];
+    }
+  }
+  return res;
+}
+
+#ifdef DEBUG
+// Prints the structural non-zero elements in triplet form.
+template <class nr_type_t> void tspmatrix<nr_type_t>::print(bool realonly) {
+  for (int c = 0; c < cols; c++) {
+    for (int i = colptr[c]; i < colptr[c + 1]; i++) {
+      if (realonly) {
+        fprintf(stderr, "(%d,%d) %+.2e\n", rowidx[i], c, (double)real(data[i]));
+      } else {
+        fprintf(stderr, "(%d,%d) %+.2e%+.2ei\n", rowidx[i], c, (double)real(data[i]),
+                (double)imag(data[i]));
+      }
+    }
+  }
+}
+#endif /* DEBUG */
+
+} // namespace qucs
@@ -0,0 +1,83 @@
+/*
+ * tspmatrix.h - sparse matrix template class definitions
+ *
+ * This is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this package; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street - Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef __TSPMATRIX_H__
+#define __TSPMATRIX_H__
+
+#include <cassert>
+#include <utility>
+#include <vector>
+
+namespace qucs {
+
+template <class nr_type_t> class tmatrix;
+
+/* A square matrix in compressed sparse column (CSC) form.  The
+ * structure is set up once by insert()'ing every structural non-zero
+ * and then compress()'ing the matrix.  Afterwards only values of
+ * entries inside the structure can be modified. */
+template <class nr_type_t> class tspmatrix {
+public:
+  tspmatrix();
+  explicit tspmatrix(int);
+  tspmatrix(const tspmatrix &) = default;
+  tspmatrix &operator=(const tspmatrix &) = default;
+  ~tspmatrix() = default;
+
+  void insert(int, int);
+  void compress();
+  bool isCompressed() const { return compressed; }
+
+  int find(int, int) const;
+  nr_type_t get(int, int) const;
+  void set(int, int, nr_type_t);
+  void add(int, int, nr_type_t);
+  void set(nr_type_t);
+
+  int getCols() const { return cols; }
+  int getRows() const { return rows; }
+  int getNonZeros() const { return (int)data.size(); }
+  int *getColPtr() { return colptr.data(); }
+  int *getRowIdx() { return rowidx.data(); }
+  nr_type_t *getData() { return data.data(); }
+
+  void transpose();
+  int isFinite();
+  tmatrix<nr_type_t> getDense();
+  void print(bool realonly = false);
+
+  // accessors for the values of the structural non-zeros
+  nr_type_t operator[](const int i) const { return data[i]; }
+  nr_type_t &operator[](const int i) { return data[i]; }
+
+private:
+  int cols;
+  int rows;
+  bool compressed;
+  std::vector<int> colptr;
+  std::vector<int> rowidx;
+  std::vector<nr_type_t> data;
+  std::vector<std::pair<int, int>> pending;
+};
+
+} // namespace qucs
+
+#include "tspmatrix.cpp"
+
+#endif /* __TSPMATRIX_H__ */
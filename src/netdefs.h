@@ -91,7 +91,7 @@ struct property_t {
     double l;           // lower bound of the value
     double h;           // upper bound of the value
     char ih;            // interval boundary
-    const char *str[8]; // possible string list
+    const char *str[10]; // possible string list
   } range;
 };
 
@@ -151,6 +151,10 @@ struct define_t {
   { '.', 0, 0, '.', { s1, s2, s3, s4, s5, s6, NULL } }
 #define PROP_RNG_STR7(s1,s2,s3,s4,s5,s6,s7) \
   { '.', 0, 0, '.', { s1, s2, s3, s4, s5, s6, s7, NULL } }
+#define PROP_RNG_STR8(s1,s2,s3,s4,s5,s6,s7,s8) \
+  { '.', 0, 0, '.', { s1, s2, s3, s4, s5, s6, s7, s8, NULL } }
+#define PROP_RNG_STR9(s1,s2,s3,s4,s5,s6,s7,s8,s9) \
+  { '.', 0, 0, '.', { s1, s2, s3, s4, s5, s6, s7, s8, s9, NULL } }
 
 #define PROP_RNG_YESNO    PROP_RNG_STR2 ("yes", "no")
 #define PROP_RNG_BJT      PROP_RNG_STR2 ("npn", "pnp")
@@ -158,8 +162,9 @@ struct define_t {
 #define PROP_RNG_MOS      PROP_RNG_STR2 ("nmos", "pmos")
 #define PROP_RNG_TYP      PROP_RNG_STR4 ("lin", "log", "list", "const")
 #define PROP_RNG_SOL \
-  PROP_RNG_STR5 ("CroutLU", "DoolittleLU", "HouseholderQR", \
-		 "HouseholderLQ", "GolubSVD")
+  PROP_RNG_STR9 ("CroutLU", "DoolittleLU", "HouseholderQR", \
+		 "HouseholderLQ", "GolubSVD", "SparseLU", "BlockedLU", \
+		 "GMRES", "BiCGStab")
 #define PROP_RNG_DIS \
   PROP_RNG_STR7 ("Kirschning", "Kobayashi", "Yamashita", "Getsinger", \
 		 "Schneider", "Pramanick", "Hammerstad")
@@ -21,6 +21,10 @@
 
 #include <algorithm>
 #include <cassert>
+#include <cstdlib>
+#include <queue>
+#include <set>
+#include <unordered_map>
 
 #include "circuit.h"
 #include "complex.h"
@@ -150,6 +154,188 @@ void nodelist::assignNodes() {
   }
 }
 
+/* Returns the number of non-zeros in the (lower) LU factor of a matrix
+ * with the structure of the given node graph when eliminating the
+ * nodes in the given order.  The rows of the factor are obtained by
+ * walking up the elimination tree. */
+static long symbolicFill(const std::vector<std::vector<int>> &adj, const std::vector<int> &order) {
+  const int n = adj.size();
+  std::vector<int> pos(n), parent(n, -1), mark(n, -1);
+  long fill = n;
+  for (int k = 0; k < n; k++)
+    pos[order[k]] = k;
+  for (int k = 0; k < n; k++) {
+    mark[k] = k;
+    for (int u : adj[order[k]]) {
+      for (int j = pos[u]; j < k && mark[j] != k; j = parent[j]) {
+        mark[j] = k;
+        fill++;
+        if (parent[j] < 0)
+          parent[j] = k;
+      }
+    }
+  }
+  return fill;
+}
+
+// Returns the bandwidth of the node graph in the given order.
+static int bandwidth(const std::vector<std::vector<int>> &adj, const std::vector<int> &order) {
+  const int n = adj.size();
+  std::vector<int> pos(n);
+  int bw = 0;
+  for (int k = 0; k < n; k++)
+    pos[order[k]] = k;
+  for (int v = 0; v < n; v++) {
+    for (int u : adj[v])
+      bw = std::max(bw, std::abs(pos[u] - pos[v]));
+  }
+  return bw;
+}
+
+/* Reverse Cuthill-McKee ordering.  Each connected component is
+ * traversed breadth-first starting at a pseudo-peripheral node,
+ * visiting the neighbours by increasing degree.  The reversed order
+ * yields a small bandwidth. */
+static std::vector<int> orderRCM(const std::vector<std::vector<int>> &adj) {
+  const int n = adj.size();
+  std::vector<int> order, level(n);
+  std::vector<bool> done(n, false);
+  order.reserve(n);
+
+  // breadth-first search returning the last node reached
+  auto bfs = [&](int s, std::vector<int> &visit) {
+    std::fill(level.begin(), level.end(), -1);
+    std::queue<int> q;
+    int last = s;
+    level[s] = 0;
+    q.push(s);
+    while (!q.empty()) {
+      int v = q.front();
+      q.pop();
+      visit.push_back(v);
+      std::vector<int> next;
+      for (int u : adj[v]) {
+        if (level[u] < 0 && !done[u]) {
+          level[u] = level[v] + 1;
+          next.push_back(u);
+        }
+      }
+      std::sort(next.begin(), next.end(),
+                [&](int a, int b) { return adj[a].size() < adj[b].size(); });
+      for (int u : next)
+        q.push(u);
+      if (level[v] > level[last] ||
+          (level[v] == level[last] && adj[v].size() < adj[last].size()))
+        last = v;
+    }
+    return last;
+  };
+
+  for (int s = 0; s < n; s++) {
+    if (done[s])
+      continue;
+    // find a pseudo-peripheral node of the component
+    std::vector<int> visit;
+    int root = s, ecc = -1;
+    for (int i = 0; i < 4; i++) {
+      visit.clear();
+      int last = bfs(root, visit);
+      if (level[last] <= ecc)
+        break;
+      ecc = level[last];
+      root = last;
+    }
+    visit.clear();
+    bfs(root, visit);
+    for (int v : visit) {
+      done[v] = true;
+      order.push_back(v);
+    }
+  }
+  std::reverse(order.begin(), order.end());
+  return order;
+}
+
+/* Minimum degree ordering.  The node of smallest degree in the
+ * elimination graph is eliminated next, its neighbours become a
+ * clique. */
+static std::vector<int> orderMinDegree(const std::vector<std::vector<int>> &adj) {
+  const int n = adj.size();
+  std::vector<std::set<int>> g(n);
+  std::set<std::pair<int, int>> degree;
+  std::vector<int> order;
+  order.reserve(n);
+  for (int v = 0; v < n; v++) {
+    g[v].insert(adj[v].begin(), adj[v].end());
+    degree.insert({(int)g[v].size(), v});
+  }
+  while (!degree.empty()) {
+    const int v = degree.begin()->second;
+    degree.erase(degree.begin());
+    order.push_back(v);
+    for (int u : g[v]) {
+      degree.erase({(int)g[u].size(), u});
+      g[u].erase(v);
+      for (int w : g[v]) {
+        if (w != u)
+          g[u].insert(w);
+      }
+      degree.insert({(int)g[u].size(), u});
+    }
+    g[v].clear();
+  }
+  return order;
+}
+
+/* Renumbers the nodes (except the ground node) using the given
+ * fill-reducing ordering of the graph connecting each pair of nodes
+ * of a circuit.  The node numbers determine the order of the rows and
+ * columns of the MNA matrix.  The bandwidth and the fill-in of the LU
+ * factors (node rows only) before and after are logged. */
+void nodelist::orderNodes(int method) {
+  const int n = (int)narray.size() - 1;
+  if (method == ORDERING_NONE || n < 3)
+    return;
+
+  // build node graph
+  std::unordered_map<circuit *, std::vector<int>> nodes;
+  for (int i = 0; i < n; i++) {
+    for (auto *nd : *narray[i + 1])
+      nodes[nd->getCircuit()].push_back(i);
+  }
+  std::vector<std::vector<int>> adj(n);
+  for (auto &c : nodes) {
+    for (int i : c.second) {
+      for (int j : c.second) {
+        if (i != j)
+          adj[i].push_back(j);
+      }
+    }
+  }
+  for (auto &a : adj) {
+    std::sort(a.begin(), a.end());
+    a.erase(std::unique(a.begin(), a.end()), a.end());
+  }
+
+  std::vector<int> natural(n);
+  for (int i = 0; i < n; i++)
+    natural[i] = i;
+  std::vector<int> order = method == ORDERING_RCM ? orderRCM(adj) : orderMinDegree(adj);
+
+  logprint(LOG_STATUS,
+           "NOTIFY: %s ordering of %d nodes, bandwidth %d -> %d, "
+           "LU fill-in %ld -> %ld\n",
+           method == ORDERING_RCM ? "RCM" : "minimum degree", n, bandwidth(adj, natural),
+           bandwidth(adj, order), symbolicFill(adj, natural), symbolicFill(adj, order));
+
+  // renumber the nodes
+  std::vector<nodelist_t *> old(narray);
+  for (int k = 0; k < n; k++) {
+    narray[k + 1] = old[order[k] + 1];
+    narray[k + 1]->index = k + 1;
+  }
+}
+
 /* Appends a node pointer to the given nodelist structure. */
 void nodelist::addCircuitNode(nodelist_t *nl, node *n) {
   (*nl).push_back(n);
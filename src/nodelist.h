@@ -25,6 +25,11 @@
 #include <list>
 #include <vector>
 
+// fill-reducing orderings of the nodes
+#define ORDERING_NONE 0
+#define ORDERING_RCM 1
+#define ORDERING_MINDEGREE 2
+
 namespace qucs {
 
 class node;
@@ -86,6 +91,7 @@ public:
   std::string get(int) const;
   bool isInternal(int) const;
   void assignNodes();
+  void orderNodes(int);
   void sort();
   void remove(circuit *);
   void insert(circuit *);
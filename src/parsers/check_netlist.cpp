@@ -314,7 +314,13 @@ static int checker_resolve_variable (struct definition_t * root,
         {
             found++;
         }
-        /* 9. find property reference in the instance */
+        /* 9. node, probe or voltage source names in noise outputs,
+           these are looked up by the AC analysis */
+        if (!strcmp (def->type, "AC") && !strcmp (pair->key, "NoiseOutput"))
+        {
+            found++;
+        }
+        /* 10. find property reference in the instance */
         if (!found &&
                 checker_is_property (def->define, value->ident) != PROP_NONE)
         {
@@ -20,10 +20,15 @@
  * Boston, MA 02110-1301, USA.
  */
 
+#include <algorithm>
 #include <cassert>
+#include <cerrno>
+#include <cstdio>
 #include <cstring>
 #include <limits>
 
+#include <unistd.h>
+
 #include "real.h"
 #include "complex.h"
 #include "object.h"
@@ -34,6 +39,22 @@
 
 namespace qucs {
 
+/* The temporary file the spilled vectors write their chunks to and
+   the chunk read from it last.  Only the process creating the file
+   writes to it, worker processes of a parameter sweep keep their new
+   values in memory.  Chunks are always appended and never reused, the
+   file grows with every value spilled and lives (already unlinked by
+   tmpfile()) until the process exits. */
+static struct {
+  FILE * file;
+  pid_t pid;
+  long end;
+  const vector * owner;
+  int index;
+  nr_complex_t * buffer;
+  int capacity;
+} spool = { NULL, 0, 0, NULL, -1, NULL, 0 };
+
 // Constructor creates an unnamed instance of the vector class.
 vector::vector () : object () {
   capacity = size = 0;
@@ -41,6 +62,9 @@ vector::vector () : object () {
   dependencies = NULL;
   origin = NULL;
   requested = 0;
+  chunk = spilled = 0;
+  spillFirst = spillLast = readOffset = -1;
+  readIndex = -1;
   next = prev = nullptr;
 }
 
@@ -54,6 +78,9 @@ vector::vector (int s) : object () {
   dependencies = NULL;
   origin = NULL;
   requested = 0;
+  chunk = spilled = 0;
+  spillFirst = spillLast = readOffset = -1;
+  readIndex = -1;
   next = prev = nullptr;
 }
 
@@ -68,6 +95,9 @@ vector::vector (int s, nr_complex_t val) : object () {
   dependencies = NULL;
   origin = NULL;
   requested = 0;
+  chunk = spilled = 0;
+  spillFirst = spillLast = readOffset = -1;
+  readIndex = -1;
   next = prev = nullptr;
 }
 
@@ -78,6 +108,9 @@ vector::vector (const std::string &n) : object (n) {
   dependencies = NULL;
   origin = NULL;
   requested = 0;
+  chunk = spilled = 0;
+  spillFirst = spillLast = readOffset = -1;
+  readIndex = -1;
   next = prev = nullptr;
 }
 
@@ -91,6 +124,9 @@ vector::vector (const std::string &n) : object (n) {
   dependencies = NULL;
   origin = NULL;
   requested = 0;
+  chunk = spilled = 0;
+  spillFirst = spillLast = readOffset = -1;
+  readIndex = -1;
   next = prev = nullptr;
 }
 
@@ -98,12 +134,21 @@ vector::vector (const std::string &n) : object (n) {
    vector object. */
 vector::vector (const vector & v) : object (v) {
   size = v.size;
-  capacity = v.capacity;
+  capacity = v.spilled ? v.size : v.capacity;
   data = (nr_complex_t *) malloc (sizeof (nr_complex_t) * capacity);
-  memcpy (data, v.data, sizeof (nr_complex_t) * size);
+  if (v.spilled) {
+    // the copy keeps all values in memory
+    for (int i = 0; i < size; i++) data[i] = const_cast<vector &> (v).get (i);
+  }
+  else {
+    memcpy (data, v.data, sizeof (nr_complex_t) * size);
+  }
   dependencies = v.dependencies ? new strlist (*v.dependencies) : NULL;
   origin = v.origin ? strdup (v.origin) : NULL;
   requested = v.requested;
+  chunk = spilled = 0;
+  spillFirst = spillLast = readOffset = -1;
+  readIndex = -1;
   next = v.next;
   prev = v.prev;
 }
@@ -113,6 +158,12 @@ vector::vector (const vector & v) : object (v) {
    properties untouched. */
 const vector& vector::operator=(const vector & v) {
   if (&v != this) {
+    if (v.spilled) {
+      *this = vector (v);
+      return *this;
+    }
+    chunk = spilled = 0; // the spilled values are replaced
+    readIndex = -1;
     size = v.size;
     capacity = v.capacity;
     if (data) { free (data); data = NULL; }
@@ -126,6 +177,7 @@ const vector& vector::operator=(const vector & v) {
 
 // Destructor deletes a vector object.
 vector::~vector () {
+  if (spool.owner == this) spool.owner = NULL;
   free (data);
   delete dependencies;
   free (origin);
@@ -146,19 +198,23 @@ void vector::setDependencies (strlist * s) {
    vector and ensures that the vector can hold the increasing number
    of data items. */
 void vector::add (nr_complex_t c) {
+  if (chunk > 0 && size - spilled >= chunk && spool.pid == getpid ()) {
+    spill ();
+  }
   if (data == NULL) {
     size = 0; capacity = 64;
     data = (nr_complex_t *) malloc (sizeof (nr_complex_t) * capacity);
   }
-  else if (size >= capacity) {
+  else if (size - spilled >= capacity) {
     capacity *= 2;
     data = (nr_complex_t *) realloc (data, sizeof (nr_complex_t) * capacity);
   }
-  data[size++] = c;
+  data[size++ - spilled] = c;
 }
 
 /* This function appends the given vector to the vector. */
 void vector::add (vector * v) {
+  unspill ();
   if (v != NULL) {
     if (data == NULL) {
       size = 0; capacity = v->getSize ();
@@ -174,15 +230,114 @@ void vector::add (vector * v) {
 
 // Returns the complex data item at the given position.
 nr_complex_t vector::get (int i) {
-  return data[i];
+  if (i >= spilled) return data[i - spilled];
+  return readChunk (i / chunk)[i % chunk];
 }
 
 void vector::set (double d, int i) {
-  data[i] = nr_complex_t (d);
+  set (nr_complex_t (d), i);
 }
 
 void vector::set (const nr_complex_t z, int i) {
-  data[i] = nr_complex_t (z);
+  if (i >= spilled) {
+    data[i - spilled] = z;
+    return;
+  }
+  int k = i / chunk;
+  long offset = locateChunk (k) + sizeof (long) + (i % chunk) * sizeof (nr_complex_t);
+  if (pwrite (fileno (spool.file), &z, sizeof (z), offset) != sizeof (z)) {
+    logprint (LOG_ERROR, "ERROR: vector `%s': cannot write spill file\n", getName ());
+  }
+  if (spool.owner == this && spool.index == k) spool.buffer[i % chunk] = z;
+}
+
+/* Makes the vector keep only its latest values in memory, the older
+   ones are written to a temporary file in chunks of the given number
+   of values.  The vector is then to be read by get() and extended by
+   add(), other operations bring all values back into memory first. */
+void vector::setSpill (int n) {
+  if (chunk > 0 || n <= 0) return;
+  if (spool.file == NULL) {
+    if ((spool.file = tmpfile ()) == NULL) {
+      logprint (LOG_ERROR, "ERROR: cannot create spill file: %s\n", strerror (errno));
+      return;
+    }
+    spool.pid = getpid ();
+  }
+  chunk = n;
+}
+
+/* Writes the oldest chunk of values held in memory to the end of the
+   temporary file and links it to the previous chunk. */
+void vector::spill (void) {
+  int fd = fileno (spool.file);
+  long next = -1, offset = spool.end;
+  if (pwrite (fd, &next, sizeof (next), offset) != sizeof (next) ||
+      pwrite (fd, data, sizeof (nr_complex_t) * chunk, offset + sizeof (next)) !=
+      (ssize_t) (sizeof (nr_complex_t) * chunk) ||
+      (spillLast >= 0 && pwrite (fd, &offset, sizeof (offset), spillLast) != sizeof (offset))) {
+    // keep the values in memory
+    logprint (LOG_ERROR, "ERROR: vector `%s': cannot write spill file\n", getName ());
+    unspill ();
+    return;
+  }
+  spool.end += sizeof (next) + sizeof (nr_complex_t) * chunk;
+  if (spillLast < 0) spillFirst = offset;
+  spillLast = offset;
+  spilled += chunk;
+  memmove (data, data + chunk, sizeof (nr_complex_t) * (size - spilled));
+}
+
+/* Returns the file offset of the given chunk following the links from
+   the chunk located last, or from the first one. */
+long vector::locateChunk (int k) {
+  if (readIndex < 0 || k < readIndex) {
+    readIndex = 0;
+    readOffset = spillFirst;
+  }
+  while (readIndex < k) {
+    if (pread (fileno (spool.file), &readOffset, sizeof (readOffset), readOffset) !=
+	sizeof (readOffset)) {
+      logprint (LOG_ERROR, "ERROR: vector `%s': cannot read spill file\n", getName ());
+    }
+    readIndex++;
+  }
+  return readOffset;
+}
+
+// Returns the values of the given spilled chunk.
+const nr_complex_t * vector::readChunk (int k) {
+  if (spool.owner == this && spool.index == k) return spool.buffer;
+  if (spool.capacity < chunk) {
+    spool.capacity = chunk;
+    spool.buffer = (nr_complex_t *)
+      realloc (spool.buffer, sizeof (nr_complex_t) * spool.capacity);
+  }
+  long offset = locateChunk (k) + sizeof (long);
+  if (pread (fileno (spool.file), spool.buffer, sizeof (nr_complex_t) * chunk, offset) !=
+      (ssize_t) (sizeof (nr_complex_t) * chunk)) {
+    logprint (LOG_ERROR, "ERROR: vector `%s': cannot read spill file\n", getName ());
+  }
+  spool.owner = this;
+  spool.index = k;
+  return spool.buffer;
+}
+
+// Brings the spilled values back into memory and stops spilling.
+void vector::unspill (void) {
+  if (chunk == 0) return;
+  if (spilled > 0) {
+    nr_complex_t * buffer = (nr_complex_t *)
+      malloc (sizeof (nr_complex_t) * std::max (size, 1));
+    for (int i = 0; i < size; i++) buffer[i] = get (i);
+    free (data);
+    data = buffer;
+    capacity = std::max (size, 1);
+  }
+  if (spool.owner == this) spool.owner = NULL;
+  chunk = spilled = 0;
+  spillFirst = spillLast = readOffset = -1;
+  readIndex = -1;
 }
 
 // The function returns the current size of the vector.
@@ -203,6 +358,7 @@ int vector::checkSizes (vector v1, vector v2) {
 // complex numbers in the 1. and 4. quadrant are counted as "abs(c)".
 // complex numbers in the 2. and 3. quadrant are counted as "-abs(c)".
 double vector::maximum (void) {
+  unspill ();
   nr_complex_t c;
   double d, max_D = -std::numeric_limits<double>::max();
   for (int i = 0; i < getSize (); i++) {
@@ -217,6 +373,7 @@ double vector::maximum (void) {
 // complex numbers in the 1. and 4. quadrant are counted as "abs(c)".
 // complex numbers in the 2. and 3. quadrant are counted as "-abs(c)".
 double vector::minimum (void) {
+  unspill ();
   nr_complex_t c;
   double d, min_D = +std::numeric_limits<double>::max();
   for (int i = 0; i < getSize (); i++) {
@@ -624,16 +781,19 @@ vector diff (vector var, vector dep, int n) {
 }
 
 vector vector::operator=(const nr_complex_t c) {
+  unspill ();
   for (int i = 0; i < size; i++) data[i] = c;
   return *this;
 }
 
 vector vector::operator=(const double d) {
+  unspill ();
   for (int i = 0; i < size; i++) data[i] = d;
   return *this;
 }
 
 vector vector::operator+=(vector v) {
+  unspill ();
   int i, n, len = v.getSize ();
   assert (size % len == 0);
   for (i = n = 0; i < size; i++) { data[i] += v (n); if (++n >= len) n = 0; }
@@ -641,11 +801,13 @@ vector vector::operator+=(vector v) {
 }
 
 vector vector::operator+=(const nr_complex_t c) {
+  unspill ();
   for (int i = 0; i < size; i++) data[i] += c;
   return *this;
 }
 
 vector vector::operator+=(const double d) {
+  unspill ();
   for (int i = 0; i < size; i++) data[i] += d;
   return *this;
 }
@@ -684,12 +846,14 @@ vector operator+(const double d, vector v) {
 }
 
 vector vector::operator-() {
+  unspill ();
   vector result (size);
   for (int i = 0; i < size; i++) result (i) = -data[i];
   return result;
 }
 
 vector vector::operator-=(vector v) {
+  unspill ();
   int i, n, len = v.getSize ();
   assert (size % len == 0);
   for (i = n = 0; i < size; i++) { data[i] -= v (n); if (++n >= len) n = 0; }
@@ -697,11 +861,13 @@ vector vector::operator-=(vector v) {
 }
 
 vector vector::operator-=(const nr_complex_t c) {
+  unspill ();
   for (int i = 0; i < size; i++) data[i] -= c;
   return *this;
 }
 
 vector vector::operator-=(const double d) {
+  unspill ();
   for (int i = 0; i < size; i++) data[i] -= d;
   return *this;
 }
@@ -744,6 +910,7 @@ vector operator-(const double d, vector v) {
 }
 
 vector vector::operator*=(vector v) {
+  unspill ();
   int i, n, len = v.getSize ();
   assert (size % len == 0);
   for (i = n = 0; i < size; i++) { data[i] *= v (n); if (++n >= len) n = 0; }
@@ -751,11 +918,13 @@ vector vector::operator*=(vector v) {
 }
 
 vector vector::operator*=(const nr_complex_t c) {
+  unspill ();
   for (int i = 0; i < size; i++) data[i] *= c;
   return *this;
 }
 
 vector vector::operator*=(const double d) {
+  unspill ();
   for (int i = 0; i < size; i++) data[i] *= d;
   return *this;
 }
@@ -794,6 +963,7 @@ vector operator*(const double d, vector v) {
 }
 
 vector vector::operator/=(vector v) {
+  unspill ();
   int i, n, len = v.getSize ();
   assert (size % len == 0);
   for (i = n = 0; i < size; i++) { data[i] /= v (n); if (++n >= len) n = 0; }
@@ -801,11 +971,13 @@ vector vector::operator/=(vector v) {
 }
 
 vector vector::operator/=(const nr_complex_t c) {
+  unspill ();
   for (int i = 0; i < size; i++) data[i] /= c;
   return *this;
 }
 
 vector vector::operator/=(const double d) {
+  unspill ();
   for (int i = 0; i < size; i++) data[i] /= d;
   return *this;
 }
@@ -898,6 +1070,7 @@ vector operator%(vector v1, vector v2) {
 
 /* This function reverses the order of the data list. */
 void vector::reverse (void) {
+  unspill ();
   nr_complex_t * buffer = (nr_complex_t *)
     malloc (sizeof (nr_complex_t) * size);
   for (int i = 0; i < size; i++) buffer[i] = data[size - 1 - i];
@@ -920,6 +1093,7 @@ char * vector::getOrigin (void) {
 /* The function returns the number of entries with the given value
    deviating no more than the given epsilon. */
 int vector::contains (nr_complex_t val, double eps) {
+  unspill ();
   int count = 0;
   for (int i = 0; i < size; i++) {
     if (abs (data[i] - val) <= eps) count++;
@@ -929,6 +1103,7 @@ int vector::contains (nr_complex_t val, double eps) {
 
 // Sorts the vector either in ascending or descending order.
 void vector::sort (bool ascending) {
+  unspill ();
   nr_complex_t t;
   for (int i = 0; i < size; i++) {
     for (int n = 0; n < size - 1; n++) {
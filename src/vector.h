@@ -23,6 +23,7 @@
 #ifndef __VECTOR_H__
 #define __VECTOR_H__
 
+#include <cassert>
 #include <limits>
 
 #include "consts.h"
@@ -76,6 +77,8 @@ class vector : public object
   int contains (nr_complex_t, double eps = std::numeric_limits<double>::epsilon());
   void sort (bool ascending = true);
   void print (void);
+  void setSpill (int);
+  int isSpilled (void) const { return chunk > 0; }
 
   double maximum  (void);
   double minimum  (void);
@@ -222,9 +225,25 @@ class vector : public object
   vector operator /= (const nr_complex_t);
   vector operator /= (const double);
 
-  // easy accessor operators
-  nr_complex_t  operator () (int i) const { return data[i]; }
-  nr_complex_t& operator () (int i) { return data[i]; }
+  /* easy accessor operators, the non-const one brings the values of a
+     spilled vector back into memory, the const one must not be used
+     on spilled vectors */
+  nr_complex_t  operator () (int i) const {
+    assert (spilled == 0);
+    return data[i];
+  }
+  nr_complex_t& operator () (int i) {
+    if (spilled > 0) {
+      unspill ();
+    }
+    return data[i];
+  }
+
+ private:
+  void spill (void);
+  void unspill (void);
+  long locateChunk (int);
+  const nr_complex_t * readChunk (int);
 
  private:
   int requested;
@@ -233,6 +252,15 @@ class vector : public object
   strlist * dependencies;
   nr_complex_t * data;
   char * origin;
+  /* Spilled vectors keep their latest values only, the older ones are
+     written in chunks of the given number of values to a temporary
+     file, each chunk preceded by the file offset of the next one. */
+  int chunk;        // values per chunk, zero if not spilled
+  int spilled;      // number of values in the file
+  long spillFirst;  // offsets of the first and the last chunk
+  long spillLast;
+  int readIndex;    // number and offset of the chunk located last
+  long readOffset;
 };
 
 /* declarations of friend functions to make them available in the